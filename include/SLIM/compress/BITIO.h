@@ -0,0 +1,238 @@
+
+#ifndef BITIO_H
+#define BITIO_H
+
+#define BITIO_VER_MAJOR  1
+#define BITIO_VER_MINOR  0
+#define BITIO_VER_BUGFIX 0
+#define BITIO_VER_HOTFIX 0
+
+#define BITIO_VER ((BITIO_VER_MAJOR << 24) | (BITIO_VER_MINOR << 16) | (BITIO_VER_BUGFIX << 8) | (BITIO_VER_HOTFIX))
+
+#include <stddef.h>
+#include <cstdint>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+	#include <intrin.h>
+#endif
+
+//--------------------------------------------------------------//
+//MSB first bit streams shared by RICE, SLDD and MASKARED. Bits
+//are gathered in a 64-bit accumulator and move to and from memory
+//a word at a time, only the stream ends are handled bytewise.
+//--------------------------------------------------------------//
+
+	typedef struct {
+		uint8_t*		out;	//Next output byte
+		uint64_t		acc;	//Pending bits in the low end
+		uint32_t		bits;	//Pending bit count, below 32 between calls
+	} BIT_WRITER;
+
+	typedef struct {
+		const uint8_t*	p;		//Next input byte
+		const uint8_t*	end;
+		uint64_t		win;	//Loaded bits from the top, zeros below them
+		uint32_t		cnt;	//Loaded bit count
+	} BIT_READER;
+
+
+//Count of leading zero bits, v must not be zero
+static inline uint32_t BIT_CLZ64(uint64_t v) {
+
+#if defined(__GNUC__) || defined(__clang__)
+	return (uint32_t)__builtin_clzll(v);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+	unsigned long idx;
+	_BitScanReverse64(&idx, v);
+	return 63u - (uint32_t)idx;
+#else
+	uint32_t n = 0;
+	while (!(v & 0x8000000000000000ull)) { v <<= 1; ++n; }
+	return n;
+#endif
+}
+
+
+//Big-endian word access, compilers fold these into one load or store
+static inline uint64_t BIT_LOAD64(const uint8_t* p) {
+
+	return	((uint64_t)p[0] << 56) | ((uint64_t)p[1] << 48) | ((uint64_t)p[2] << 40) | ((uint64_t)p[3] << 32) |
+			((uint64_t)p[4] << 24) | ((uint64_t)p[5] << 16) | ((uint64_t)p[6] << 8)  |  (uint64_t)p[7];
+}
+
+
+static inline void BIT_STORE64(uint8_t* p, uint64_t v) {
+
+	p[0] = (uint8_t)(v >> 56); p[1] = (uint8_t)(v >> 48); p[2] = (uint8_t)(v >> 40); p[3] = (uint8_t)(v >> 32);
+	p[4] = (uint8_t)(v >> 24); p[5] = (uint8_t)(v >> 16); p[6] = (uint8_t)(v >> 8);  p[7] = (uint8_t)v;
+}
+
+
+static inline void BIT_WRITER_INIT(BIT_WRITER& w, uint8_t* out) {
+
+	w.out	= out;
+	w.acc	= 0;
+	w.bits	= 0;
+}
+
+
+//Appends the count low bits of value, count 0..32
+static inline void BIT_PUT(BIT_WRITER& w, uint32_t value, uint32_t count) {
+
+	w.acc	= (w.acc << count) | value;
+	w.bits	+= count;
+
+	if (w.bits >= 32) {
+		w.bits -= 32;
+
+		const uint32_t word = (uint32_t)(w.acc >> w.bits);
+
+		w.out[0] = (uint8_t)(word >> 24);
+		w.out[1] = (uint8_t)(word >> 16);
+		w.out[2] = (uint8_t)(word >> 8);
+		w.out[3] = (uint8_t)word;
+		w.out += 4;
+	}
+}
+
+
+//Appends the count low bits of value, count 0..64
+static inline void BIT_PUT64(BIT_WRITER& w, uint64_t value, uint32_t count) {
+
+	if (count > 32) {
+		BIT_PUT(w, (uint32_t)(value >> 32), count - 32);
+		count = 32;
+	}
+
+	BIT_PUT(w, (uint32_t)value, count);
+}
+
+
+//Appends count one bits
+static inline void BIT_PUT_ONES(BIT_WRITER& w, uint32_t count) {
+
+	for (; count >= 32; count -= 32) { BIT_PUT(w, 0xFFFFFFFFu, 32); }
+
+	BIT_PUT(w, (uint32_t)((1ull << count) - 1u), count);
+}
+
+
+//Writes the pending bits, the last byte is padded with zeros
+static inline uint8_t* BIT_FLUSH(BIT_WRITER& w) {
+
+	while (w.bits >= 8) {
+		w.bits -= 8;
+		*w.out++ = (uint8_t)(w.acc >> w.bits);
+	}
+
+	if (w.bits > 0) {
+		*w.out++ = (uint8_t)(w.acc << (8 - w.bits));
+		w.bits = 0;
+	}
+
+	return w.out;
+}
+
+
+static inline void BIT_READER_INIT(BIT_READER& r, const uint8_t* buf, size_t size) {
+
+	r.p		= buf;
+	r.end	= buf + size;
+	r.win	= 0;
+	r.cnt	= 0;
+}
+
+
+//Tops the window up to at least 57 bits while input remains
+static inline void BIT_REFILL(BIT_READER& r) {
+
+	if (r.end - r.p >= 8) {
+		r.win	|= BIT_LOAD64(r.p) >> r.cnt;
+		r.p		+= (63 - r.cnt) >> 3;
+		r.cnt	|= 56;
+		return;
+	}
+
+	while (r.cnt <= 56 && r.p < r.end) {
+		r.win |= (uint64_t)(*r.p++) << (56 - r.cnt);
+		r.cnt += 8;
+	}
+}
+
+
+//Next count bits without consuming them, count 1..32. Past the
+//end of the input the stream reads as zeros.
+static inline uint32_t BIT_PEEK(BIT_READER& r, uint32_t count) {
+
+	if (r.cnt < count) { BIT_REFILL(r); }
+
+	return (uint32_t)(r.win >> (64 - count));
+}
+
+
+static inline void BIT_SKIP(BIT_READER& r, uint32_t count) {
+
+	r.win <<= count;
+	r.cnt = (r.cnt > count) ? r.cnt - count : 0;
+}
+
+
+//Reads count bits, count 0..32
+static inline uint32_t BIT_GET(BIT_READER& r, uint32_t count) {
+
+	if (count == 0) { return 0; }
+
+	const uint32_t v = BIT_PEEK(r, count);
+
+	BIT_SKIP(r, count);
+
+	return v;
+}
+
+
+//Reads count bits, count 0..64
+static inline uint64_t BIT_GET64(BIT_READER& r, uint32_t count) {
+
+	if (count <= 32) { return BIT_GET(r, count); }
+
+	const uint64_t hi = BIT_GET(r, count - 32);
+
+	return (hi << 32) | BIT_GET(r, 32);
+}
+
+
+//Reads a run of one bits and the zero that ends it, returns the run
+//length. The run is counted a window at a time with BIT_CLZ64.
+static inline uint32_t BIT_GET_UNARY(BIT_READER& r) {
+
+	uint32_t q = 0;
+
+	for (;;) {
+		if (r.cnt < 57) { BIT_REFILL(r); }
+
+		const uint64_t inv	= ~r.win;
+		const uint32_t n	= inv ? BIT_CLZ64(inv) : 64;
+
+		//Two skips, a full window would be a shift by 64
+		if (n < r.cnt) {
+			BIT_SKIP(r, n);
+			BIT_SKIP(r, 1);
+			return q + n;
+		}
+
+		//Every loaded bit is a one. Bits below the count are copies of
+		//the next byte and come back on refill, past the end of the
+		//input the stream reads as zeros.
+		q += r.cnt;
+		r.win = 0;
+		r.cnt = 0;
+
+		if (r.p == r.end) {
+			BIT_SKIP(r, 1);
+			return q;
+		}
+	}
+}
+
+
+#endif // BITIO_H
@@ -0,0 +1,147 @@
+
+#ifndef CPUID_H
+#define CPUID_H
+
+#define CPUID_VER_MAJOR  1
+#define CPUID_VER_MINOR  0
+#define CPUID_VER_BUGFIX 0
+#define CPUID_VER_HOTFIX 0
+
+#define CPUID_VER ((CPUID_VER_MAJOR << 24) | (CPUID_VER_MINOR << 16) | (CPUID_VER_BUGFIX << 8) | (CPUID_VER_HOTFIX))
+
+#include <cstdint>
+
+//--------------------------------------------------------------//
+//Runtime x86-64 feature detection for the codec kernels. Kernels are
+//built with CPU_TARGET so the rest of the tree keeps its baseline
+//flags, and are only called when CPU_FEATURES reports support.
+//--------------------------------------------------------------//
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+	#define CPU_X64 1
+	#define CPU_TARGET(x) __attribute__((target(x)))
+	#include <cpuid.h>
+	#include <immintrin.h>
+#elif defined(_M_X64) && defined(_MSC_VER)
+	#define CPU_X64 1
+	#define CPU_TARGET(x)
+	#include <intrin.h>
+	#include <immintrin.h>
+#else
+	#define CPU_X64 0
+	#define CPU_TARGET(x)
+#endif
+
+#define CPU_SSE2		0x01u
+#define CPU_AVX2		0x02u
+#define CPU_BMI2		0x04u
+#define CPU_FAST_PDEP	0x08u	//BMI2 with PEXT/PDEP in hardware, not microcoded
+
+
+//PEXT/PDEP run in hardware for the CPUID leaf 0 vendor (EBX, ECX, EDX)
+//and family. AMD before Zen 3 runs them in microcode at hundreds of
+//cycles, Hygon family 18h is built on Zen 1 and does the same.
+static inline bool CPU_PDEP_FAST(const uint32_t vendor[3], uint32_t family) {
+
+	const bool amd		= (vendor[0] == 0x68747541u && vendor[2] == 0x69746E65u && vendor[1] == 0x444D4163u);	//AuthenticAMD
+	const bool hygon	= (vendor[0] == 0x6F677948u && vendor[2] == 0x6E65476Eu && vendor[1] == 0x656E6975u);	//HygonGenuine
+
+	return !(amd || hygon) || family >= 0x19u;
+}
+
+
+#if CPU_X64
+
+static inline void CPU_QUERY(uint32_t leaf, uint32_t sub, uint32_t r[4]) {
+
+#if defined(_MSC_VER)
+	int v[4];
+	__cpuidex(v, (int)leaf, (int)sub);
+	r[0] = (uint32_t)v[0]; r[1] = (uint32_t)v[1]; r[2] = (uint32_t)v[2]; r[3] = (uint32_t)v[3];
+#else
+	__cpuid_count(leaf, sub, r[0], r[1], r[2], r[3]);
+#endif
+}
+
+
+static inline uint64_t CPU_XCR0() {
+
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	uint32_t lo, hi;
+	__asm__ __volatile__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+	return ((uint64_t)hi << 32) | lo;
+#endif
+}
+
+
+static inline uint32_t CPU_DETECT() {
+
+	uint32_t r[4];
+	uint32_t flags = 0;
+
+	CPU_QUERY(0, 0, r);
+	const uint32_t maxLeaf	= r[0];
+	const uint32_t vendor[3] = { r[1], r[2], r[3] };
+
+	if (maxLeaf < 1) { return flags; }
+
+	CPU_QUERY(1, 0, r);
+	uint32_t family = (r[0] >> 8) & 0x0Fu;
+	if (family == 0x0Fu) { family += (r[0] >> 20) & 0xFFu; }
+
+	if (r[3] & (1u << 26)) { flags |= CPU_SSE2; }
+
+	//AVX state must also be enabled by the OS
+	const bool ymm = (r[2] & (1u << 27)) && (r[2] & (1u << 28)) && ((CPU_XCR0() & 0x06u) == 0x06u);
+
+	if (maxLeaf < 7) { return flags; }
+
+	CPU_QUERY(7, 0, r);
+	if (ymm && (r[1] & (1u << 5))) { flags |= CPU_AVX2; }
+	if (r[1] & (1u << 8)) {
+		flags |= CPU_BMI2;
+		if (CPU_PDEP_FAST(vendor, family)) { flags |= CPU_FAST_PDEP; }
+	}
+
+	return flags;
+}
+
+
+//Index of the lowest set bit, v must not be zero
+static inline uint32_t CPU_CTZ32(uint32_t v) {
+
+#if defined(_MSC_VER)
+	unsigned long idx;
+	_BitScanForward(&idx, v);
+	return (uint32_t)idx;
+#else
+	return (uint32_t)__builtin_ctz(v);
+#endif
+}
+
+#endif // CPU_X64
+
+
+//Flags CPU_FEATURES may report, tests clear bits to run the portable paths
+static inline uint32_t& CPU_ALLOWED() {
+
+	static uint32_t allowed = ~0u;
+	return allowed;
+}
+
+
+//Feature flags of the running CPU, detected once
+static inline uint32_t CPU_FEATURES() {
+
+#if CPU_X64
+	static const uint32_t flags = CPU_DETECT();
+	return flags & CPU_ALLOWED();
+#else
+	return 0;
+#endif
+}
+
+
+#endif // CPUID_H
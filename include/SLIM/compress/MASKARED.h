@@ -37,10 +37,10 @@ extern "C" {
 
 	extern uint32_t        MASKARED_VERSION		    ();
 
-	extern MASKARED_RESULT MASKARED_SIZE_CALC		(uint8_t* buf, uint32_t size, uint32_t& sizec, uint8_t mask = 0x00u);
+	extern MASKARED_RESULT MASKARED_SIZE_CALC		(const uint8_t* buf, uint32_t size, uint32_t& sizec, uint8_t mask = 0x00u);
 
 	extern MASKARED_RESULT MASKARED_ENCODE		    (uint8_t* buf, uint32_t size, uint8_t*& bufc, uint32_t& sizec);
-	extern MASKARED_RESULT MASKARED_DECODE		    (uint8_t* buf, uint32_t size, uint8_t*& bufd, uint32_t  sized);
+	extern MASKARED_RESULT MASKARED_DECODE		    (const uint8_t* buf, uint32_t size, uint8_t*& bufd, uint32_t  sized);
 
 
 #ifdef __cplusplus
@@ -49,19 +49,21 @@ extern "C" {
 
 #ifdef SLEP_MASKARED_IMP
 
-uint32_t MASKARED_VERSION(){ return MASKARED_VER; }
+#include "./BITIO.h"
+#include "./CPUID.h"
 
+uint32_t MASKARED_VERSION(){ return MASKARED_VER; }
 
-MASKARED_RESULT MASKARED_SIZE_CALC(uint8_t* buf, uint32_t size, uint32_t& sizec, uint8_t mask) {
 
-	if (buf == NULL || size <= 0) { return MASKARED_RESULT::SL_ERROR_INVALID_PARAM; }
+static uint32_t MASKARED_ANALYZE(const uint8_t* buf, uint32_t size, uint8_t& mask, uint8_t& accum) {
 
 	const uint8_t first = *buf;
 	const uint8_t* end	= buf + size;
-	uint8_t accum		= 0x00u;
 	uint32_t step		= 0x00u;
 
-	for (uint8_t* p = buf; p < end && mask != 0xFFu; ++p) {
+	accum = 0x00u;
+
+	for (const uint8_t* p = buf; p < end && mask != 0xFFu; ++p) {
 		mask |= (first ^ *p);
 	}
 
@@ -74,55 +76,130 @@ MASKARED_RESULT MASKARED_SIZE_CALC(uint8_t* buf, uint32_t size, uint32_t& sizec,
 		}
 	}
 
-	uint32_t total = size * (0x08u - step);
-	sizec = (step + total + 0x0Fu) >> 0x03u;
+	return step;
+}
 
-	return MASKARED_RESULT::SL_OK;
+
+//Gathers the bits of v under mask into the low bits, the highest first
+static inline uint32_t MASKARED_EXTRACT(uint32_t v, uint32_t mask) {
+
+	uint32_t out = 0x00u;
+
+	for (uint32_t bit = 0x80u; bit > 0x00u; bit >>= 0x01u) {
+		if (mask & bit) { out = (out << 1) | ((v & bit) != 0); }
+	}
+
+	return out;
 }
 
 
+//Scatters the low bits of v back under mask, the inverse of MASKARED_EXTRACT
+static inline uint32_t MASKARED_DEPOSIT(uint32_t v, uint32_t mask) {
 
-MASKARED_RESULT MASKARED_ENCODE(uint8_t* buf, uint32_t size, uint8_t*& bufc, uint32_t& sizec) {
+	uint32_t out = 0x00u;
 
-    if (buf == NULL || bufc == NULL  || size <= 0) { return MASKARED_RESULT::SL_ERROR_INVALID_PARAM; }
+	for (uint32_t bit = 0x01u; bit < 0x100u; bit <<= 0x01u) {
+		if (mask & bit) {
+			if (v & 0x01u) { out |= bit; }
+			v >>= 0x01u;
+		}
+	}
 
-	uint8_t* pstr		= bufc + 0x01u;
-	const uint8_t first = *buf;
-	const uint8_t* end	= buf + size;
-	uint8_t mask		= 0x00u;
-	uint8_t accum		= 0x00u;
-	uint32_t step		= 0x00u;
+	return out;
+}
 
-	for (uint8_t* p = buf; p < end && mask != 0xFFu; ++p) {
-		mask |= (first ^ *p);
+
+#if CPU_X64
+
+//Eight bytes per step: one PEXT gathers the masked bits of a big-endian
+//word in stream order. Returns the count of bytes packed.
+CPU_TARGET("bmi2") static uint32_t MASKARED_PACK_BMI2(BIT_WRITER& w, const uint8_t* buf, uint32_t size, uint8_t mask, uint32_t width) {
+
+	const uint64_t mask64	= 0x0101010101010101ull * mask;
+	uint32_t i				= 0;
+
+	for (; i + 0x08u <= size; i += 0x08u) {
+		BIT_PUT64(w, _pext_u64(BIT_LOAD64(buf + i), mask64), width * 0x08u);
 	}
 
-	for (uint8_t bit = 0x80u; bit > 0x00u; bit >>= 0x01u) {
-		if (!(mask & bit)) {
-			if (first & bit) {
-				accum |= (0x80u >> step);
-			}
-			++step;
+	return i;
+}
+
+
+//Inverse of MASKARED_PACK_BMI2, one PDEP per eight bytes. Returns the count of bytes written.
+CPU_TARGET("bmi2") static uint32_t MASKARED_UNPACK_BMI2(BIT_READER& r, uint8_t* bufd, uint32_t sized, uint8_t mask, uint8_t chr, uint32_t width) {
+
+	const uint64_t mask64	= 0x0101010101010101ull * mask;
+	const uint64_t chr64	= 0x0101010101010101ull * chr;
+	uint32_t i				= 0;
+
+	for (; i + 0x08u <= sized; i += 0x08u) {
+		BIT_STORE64(bufd + i, _pdep_u64(BIT_GET64(r, width * 0x08u), mask64) | chr64);
+	}
+
+	return i;
+}
+
+#endif // CPU_X64
+
+
+MASKARED_RESULT MASKARED_SIZE_CALC(const uint8_t* buf, uint32_t size, uint32_t& sizec, uint8_t mask) {
+
+	if (buf == NULL || size <= 0) { return MASKARED_RESULT::SL_ERROR_INVALID_PARAM; }
+
+	uint8_t accum		= 0x00u;
+	const uint32_t step	= MASKARED_ANALYZE(buf, size, mask, accum);
+	const uint32_t width = 0x08u - step;
+
+	//Mask and accum bytes always survive the tails remover
+	sizec = 2;
+
+	for (uint32_t i = size; width > 0 && i > 0; --i) {
+		const uint32_t bits = buf[i - 1] & mask;
+		if (bits == 0) { continue; }
+
+		//Position of the last set bit in the packed stream
+		uint32_t last = step + (i - 1) * width;
+		for (uint32_t bit = 0x80u; bit > (bits & (0u - bits)); bit >>= 0x01u) {
+			if (mask & bit) { ++last; }
 		}
+
+		sizec = 0x02u + (last >> 0x03u);
+		break;
 	}
 
-	uint32_t total = size * (0x08u - step);
-	sizec = (step + total + 0x0Fu) >> 0x03u;
+	return MASKARED_RESULT::SL_OK;
+}
+
+
+MASKARED_RESULT MASKARED_ENCODE(uint8_t* buf, uint32_t size, uint8_t*& bufc, uint32_t& sizec) {
+
+    if (buf == NULL || bufc == NULL  || size <= 0) { return MASKARED_RESULT::SL_ERROR_INVALID_PARAM; }
+
+	uint8_t mask		= 0x00u;
+	uint8_t accum		= 0x00u;
+	const uint32_t step	= MASKARED_ANALYZE(buf, size, mask, accum);
+	const uint32_t width = 0x08u - step;
 
 	*bufc = mask;
-	*pstr = accum;
-
-	for (uint8_t* p = buf, *c = pstr; p < end; ++p) {
-		for (uint8_t bit = 0x80u; bit > 0x00u; bit >>= 0x01u) {
-			if (mask & bit) {
-				if (*p & bit) {
-					c = pstr + (step >> 0x03u);
-					*c |= (0x80u >> (step & 0x07u));
-				}
-				++step;
-			}
-		}
+
+	//The accum bits lead the stream, the masked bits of every byte follow
+	BIT_WRITER w;
+	BIT_WRITER_INIT(w, bufc + 0x01u);
+	BIT_PUT(w, accum >> width, step);
+
+	uint32_t i = 0;
+
+#if CPU_X64
+	if (CPU_FEATURES() & CPU_FAST_PDEP) { i = MASKARED_PACK_BMI2(w, buf, size, mask, width); }
+#endif
+
+	for (; i < size; ++i) {
+		BIT_PUT(w, MASKARED_EXTRACT(buf[i], mask), width);
 	}
+
+	sizec = uint32_t(BIT_FLUSH(w) - bufc);
+
 	//Tails remover
 	while (sizec > 2 && bufc[sizec - 1] == 0) {
 		--sizec;
@@ -132,15 +209,13 @@ MASKARED_RESULT MASKARED_ENCODE(uint8_t* buf, uint32_t size, uint8_t*& bufc, uin
 }
 
 
-MASKARED_RESULT MASKARED_DECODE(uint8_t* buf, uint32_t size, uint8_t*& bufd, uint32_t sized) {
+MASKARED_RESULT MASKARED_DECODE(const uint8_t* buf, uint32_t size, uint8_t*& bufd, uint32_t sized) {
 
     if (buf == NULL || bufd == NULL  || size <= 0 || sized <= 0 ) { return MASKARED_RESULT::SL_ERROR_INVALID_PARAM; }
 
-	uint8_t* pstr		= buf + 0x01u;
+	const uint8_t* pstr	= buf + 0x01u;
 	const uint8_t mask	= *buf;
 	const uint8_t accum = *pstr;
-	const uint8_t* endd = bufd + sized;
-	const uint8_t* endp = buf + size;
 	uint8_t  chr		= 0x00u;
 	uint32_t step		= 0x00u;
 
@@ -153,14 +228,21 @@ MASKARED_RESULT MASKARED_DECODE(uint8_t* buf, uint32_t size, uint8_t*& bufd, uin
 		}
 	}
 
-	for (uint8_t* d = bufd, *p = pstr; d < endd; ++d) {
-		*d = chr;
-		for (uint8_t bit = 0x80u; bit > 0x00u && p < endp; bit >>= 0x01u) {
-			if (mask & bit) {
-				if (*p & (0x80u >> (step & 0x07u))) { *d |= bit; }
-				p = pstr + (++step >> 0x03u);
-			}
-		}
+	const uint32_t width = 0x08u - step;
+
+	//Bits past the end of the data read as zeros and leave chr alone
+	BIT_READER r;
+	BIT_READER_INIT(r, pstr, size - 0x01u);
+	BIT_GET(r, step);
+
+	uint32_t i = 0;
+
+#if CPU_X64
+	if (CPU_FEATURES() & CPU_FAST_PDEP) { i = MASKARED_UNPACK_BMI2(r, bufd, sized, mask, chr, width); }
+#endif
+
+	for (; i < sized; ++i) {
+		bufd[i] = chr | (uint8_t)MASKARED_DEPOSIT(BIT_GET(r, width), mask);
 	}
 
     return MASKARED_RESULT::SL_OK;
@@ -23,10 +23,17 @@ extern "C" {
 
 	} RICE_RESULT;
 
+	typedef enum {
+		RICE_K_MEAN = 0,		//k from the mean of the block
+		RICE_K_EXACT = 1		//k with the smallest stream, from the exact size of every k
+
+	} RICE_K_MODE;
+
 	extern uint32_t     RICE_VERSION		();
 
-	extern RICE_RESULT  RICE_ENCODE		    (uint8_t* buf, uint32_t size, uint8_t*& bufc, uint32_t& sizec);
-	extern RICE_RESULT  RICE_DECODE		    (uint8_t* buf, uint32_t size, uint8_t*& bufd, uint32_t  sized);
+	extern RICE_RESULT  RICE_SIZE_CALC	    (const uint8_t* buf, uint32_t size, uint32_t& sizec, RICE_K_MODE mode = RICE_K_MEAN);
+	extern RICE_RESULT  RICE_ENCODE		    (uint8_t* buf, uint32_t size, uint8_t*& bufc, uint32_t& sizec, RICE_K_MODE mode = RICE_K_MEAN);
+	extern RICE_RESULT  RICE_DECODE		    (const uint8_t* buf, uint32_t size, uint8_t*& bufd, uint32_t  sized);
 
 
 #ifdef __cplusplus
@@ -35,13 +42,13 @@ extern "C" {
 
 #ifdef RICE_IMP
 
+#include "./BITIO.h"
+
 uint32_t RICE_VERSION(){ return RICE_VER; }
 
 
-RICE_RESULT RICE_ENCODE(uint8_t* buf, uint32_t size, uint8_t*& bufc, uint32_t& sizec)
+static uint8_t RICE_PARAM(const uint8_t* buf, uint32_t size)
 {
-    if (buf == NULL || bufc == NULL  || size <= 0) { return RICE_RESULT::RICE_ERROR_INVALID_PARAM; }
-
     double avg = 0.0;
     for (uint32_t i = 0; i < size; ++i){
         avg += buf[i];
@@ -61,96 +68,120 @@ RICE_RESULT RICE_ENCODE(uint8_t* buf, uint32_t size, uint8_t*& bufc, uint32_t& s
         else if (avg >= 2.0)  {k = 1;}
     }
 
-    bufc[0] = k;
-    uint32_t bitPos = 8;
+    return k;
+}
 
-    for (uint32_t i = 0; i < size; ++i)
+
+static uint8_t RICE_PARAM_EXACT(const uint8_t* buf, uint32_t size)
+{
+    //A k stream takes size * (1 + k) bits plus the sum of v >> k. Adding
+    //neighbouring histogram bins turns the counts of v >> k into the
+    //counts of v >> (k + 1), so one histogram prices every k.
+    uint32_t hist[256] = {0};
+    uint32_t top = 0;
+    for (uint32_t i = 0; i < size; ++i){
+        ++hist[buf[i]];
+        top |= buf[i];
+    }
+
+    uint32_t best = 0xFFFFFFFFu;
+    uint8_t k = 0;
+
+    //Bins past top are empty, top >> k bounds every pass
+    for (uint32_t kk = 0; kk < 8; ++kk, top >>= 1)
     {
-        uint32_t v = buf[i];
-        uint32_t q = v >> k;
-        uint32_t r = v & ((1u << k) - 1);
+        uint32_t bits = size * (1u + kk);
+        for (uint32_t u = 1; u <= top; ++u){
+            bits += u * hist[u];
+        }
 
+        if (bits < best) { best = bits; k = uint8_t(kk); }
+        if (top == 0) { break; }
 
-        for (uint32_t j = 0; j < q; ++j)
-        {
-            uint32_t bytePos = bitPos >> 3;
-            bufc[bytePos] |= (1u << (7 - (bitPos & 7)));
-            bitPos++;
+        for (uint32_t u = 0; u <= top / 2; ++u){
+            hist[u] = hist[2 * u] + ((2 * u + 1 <= top) ? hist[2 * u + 1] : 0u);
         }
+    }
+
+    return k;
+}
 
 
-        ++bitPos;
+RICE_RESULT RICE_SIZE_CALC(const uint8_t* buf, uint32_t size, uint32_t& sizec, RICE_K_MODE mode)
+{
+    if (buf == NULL || size <= 0) { return RICE_RESULT::RICE_ERROR_INVALID_PARAM; }
 
+    const uint8_t k = (mode == RICE_K_EXACT) ? RICE_PARAM_EXACT(buf, size) : RICE_PARAM(buf, size);
 
-        for (int b = (int)k - 1; b >= 0; --b)
-        {
-            uint32_t bytePos = bitPos >> 3;
-            uint32_t bit = (r >> b) & 1u;
-            if (bit)
-                bufc[bytePos] |= (1u << (7 - (bitPos & 7)));
-            bitPos++;
-        }
+    //Every value costs its quotient in ones, a zero stop bit and k remainder bits
+    uint32_t bitPos = 8 + size * (1u + k);
+    for (uint32_t i = 0; i < size; ++i){
+        bitPos += uint32_t(buf[i]) >> k;
     }
 
     sizec = (bitPos + 7) / 8;
 
-	return RICE_RESULT::RICE_OK;
+    return RICE_RESULT::RICE_OK;
 }
 
 
-RICE_RESULT RICE_DECODE(uint8_t* buf, uint32_t size, uint8_t*& bufd, uint32_t sized)
+RICE_RESULT RICE_ENCODE(uint8_t* buf, uint32_t size, uint8_t*& bufc, uint32_t& sizec, RICE_K_MODE mode)
 {
-    if (buf == NULL || bufd == NULL || size == 0 || sized == 0) {return RICE_RESULT::RICE_ERROR_INVALID_PARAM; }
+    if (buf == NULL || bufc == NULL  || size <= 0) { return RICE_RESULT::RICE_ERROR_INVALID_PARAM; }
 
-    uint32_t bitPos = 8;
-    uint8_t k = buf[0];
-    const uint32_t totalBits = size * 8u;
+    const uint8_t k = (mode == RICE_K_EXACT) ? RICE_PARAM_EXACT(buf, size) : RICE_PARAM(buf, size);
 
-    bool endOfData = false;
+    bufc[0] = k;
 
-    for (uint32_t i = 0; i < sized; ++i)
+    BIT_WRITER w;
+    BIT_WRITER_INIT(w, bufc + 1);
+
+    for (uint32_t i = 0; i < size; ++i)
     {
-        if (bitPos >= totalBits) {
-            break;
+        const uint32_t v = buf[i];
+        const uint32_t q = v >> k;
+        const uint32_t r = v & ((1u << k) - 1);
+
+        //Quotient ones, zero stop bit and remainder as one code when it fits a put
+        if (q + 1u + k <= 32u) {
+            BIT_PUT(w, (uint32_t)(((1ull << q) - 1u) << (k + 1u)) | r, q + 1u + k);
+        }
+        else {
+            BIT_PUT_ONES(w, q);
+            BIT_PUT(w, r, k + 1u);
         }
+    }
 
-        uint32_t q = 0;
+    sizec = uint32_t(BIT_FLUSH(w) - bufc);
 
+	return RICE_RESULT::RICE_OK;
+}
 
-        while (true)
-        {
-            if (bitPos >= totalBits) {
-                endOfData = true;
-                break;
-            }
 
-            uint32_t bytePos = bitPos >> 3;
-            uint32_t bit = (buf[bytePos] >> (7 - (bitPos & 7))) & 1u;
-            ++bitPos;
+RICE_RESULT RICE_DECODE(const uint8_t* buf, uint32_t size, uint8_t*& bufd, uint32_t sized)
+{
+    if (buf == NULL || bufd == NULL || size == 0 || sized == 0) {return RICE_RESULT::RICE_ERROR_INVALID_PARAM; }
 
-            if (bit == 0) {break;}
-            ++q;
-        }
+    const uint32_t k = buf[0];
+    if (k > 7) { return RICE_RESULT::RICE_ERROR_DATA; }
 
-        if (endOfData) {break;}
+    uint32_t bitPos = 8;
+    const uint32_t totalBits = size * 8u;
 
-        uint32_t r = 0;
-        for (uint32_t b = 0; b < k; ++b)
-        {
-            if (bitPos >= totalBits) {
-                endOfData = true;
-                break;
-            }
+    BIT_READER r;
+    BIT_READER_INIT(r, buf + 1, size - 1);
 
-            uint32_t bytePos = bitPos >> 3;
-            uint32_t bit = (buf[bytePos] >> (7 - (bitPos & 7))) & 1u;
-            r = (r << 1) | bit;
-            ++bitPos;
-        }
+    for (uint32_t i = 0; i < sized; ++i)
+    {
+        //The stream reads as zeros past its end, so the stop bit is always found
+        const uint32_t q = BIT_GET_UNARY(r);
+        const uint32_t rem = BIT_GET(r, k);
 
-        if (endOfData){break;}
+        //A value cut by the end of data is not written
+        bitPos += q + 1u + k;
+        if (bitPos > totalBits) {break;}
 
-        bufd[i] = uint8_t((q << k) | r);
+        bufd[i] = uint8_t((q << k) | rem);
     }
 
     return RICE_RESULT::RICE_OK;
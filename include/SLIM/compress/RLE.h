@@ -25,8 +25,10 @@ extern "C" {
 
 	extern uint32_t   RLE_VERSION		();
 
+	extern RLE_RESULT RLE_SIZE_CALC	(const uint8_t* buf, uint32_t size, uint32_t& sizec);
 	extern RLE_RESULT RLE_ENCODE		(uint8_t* buf, uint32_t size, uint8_t*& bufc, uint32_t& sizec);
-	extern RLE_RESULT RLE_DECODE		(uint8_t* data, uint32_t Length, uint8_t* &outdata, uint32_t &counter);
+	extern RLE_RESULT RLE_DECODE		(const uint8_t* data, uint32_t Length, uint8_t* &outdata, uint32_t &counter);
+	extern RLE_RESULT RLE_DECODE_SAFE	(const uint8_t* data, uint32_t Length, uint8_t* &outdata, uint32_t &counter, uint32_t capacity);
 
 
 #ifdef __cplusplus
@@ -35,19 +37,95 @@ extern "C" {
 
 #ifdef RLE_IMP
 
+#include <cstring>
+#include "./CPUID.h"
+
 uint32_t RLE_VERSION(){ return RLE_VER; }
 
 
+//Length of the run of data[i] that starts at i, at most 127
+static inline uint32_t RLE_RUN(const uint8_t* data, uint32_t i, uint32_t Length, bool sse2)
+{
+	const uint32_t limit = (Length - i < 127) ? Length - i : 127;
+	uint32_t cnt = 1;
+
+#if CPU_X64
+	const __m128i v = _mm_set1_epi8((char)data[i]);
+
+	for (; sse2 && cnt + 16 <= limit; cnt += 16) {
+		const uint32_t eq = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + i + cnt)), v));
+		if (eq != 0xFFFFu) { return cnt + CPU_CTZ32(~eq); }
+	}
+#else
+	(void)sse2;
+#endif
+
+	while (cnt < limit && data[i + cnt] == data[i]) { ++cnt; }
+
+	return cnt;
+}
+
+
+//Length of the literal that starts at i: it ends before the first pair of equal neighbours, at most 127
+static inline uint32_t RLE_LITERAL(const uint8_t* data, uint32_t i, uint32_t Length, bool sse2)
+{
+	const uint32_t limit = (Length - i < 127) ? Length - i : 127;
+	uint32_t cnt = 0;
+
+#if CPU_X64
+	for (; sse2 && cnt + 16 <= limit && i + cnt + 17 <= Length; cnt += 16) {
+		const __m128i a = _mm_loadu_si128((const __m128i*)(data + i + cnt));
+		const __m128i b = _mm_loadu_si128((const __m128i*)(data + i + cnt + 1));
+		const uint32_t eq = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(a, b));
+		if (eq != 0) { return cnt + CPU_CTZ32(eq); }
+	}
+#else
+	(void)sse2;
+#endif
+
+	while (cnt < limit && (i + cnt + 1 >= Length || data[i + cnt] != data[i + cnt + 1])) { ++cnt; }
+
+	return cnt;
+}
+
+
+RLE_RESULT RLE_SIZE_CALC(const uint8_t* data, uint32_t Length, uint32_t &counter)
+{
+    if (data == NULL || Length <= 0) { return RLE_RESULT::RLE_ERROR_INVALID_PARAM; }
+
+	//Same run split as RLE_ENCODE, only the output is counted
+	const bool sse2 = (CPU_FEATURES() & CPU_SSE2) != 0;
+	uint32_t idx = 0;
+	uint32_t i = 0;
+
+	while (i < Length) {
+		uint32_t cnt = RLE_RUN(data, i, Length, sse2);
+
+		if (cnt > 1) {
+			idx += 2;
+			i += cnt;
+		}
+		else {
+			cnt = RLE_LITERAL(data, i, Length, sse2);
+			idx += 1 + cnt;
+			i += cnt;
+		}
+	}
+	counter = idx;
+	return RLE_RESULT::RLE_OK;
+}
+
+
 RLE_RESULT RLE_ENCODE(uint8_t* data, uint32_t Length, uint8_t* &outdata, uint32_t &counter)
 {
     if (data == NULL || outdata == NULL  || Length <= 0) { return RLE_RESULT::RLE_ERROR_INVALID_PARAM; }
 
+	const bool sse2 = (CPU_FEATURES() & CPU_SSE2) != 0;
 	uint32_t idx = 0;
 	uint32_t i = 0;
 
 	while (i < Length) {
-		uint32_t cnt = 1;
-		while (i + cnt < Length && data[i + cnt] == data[i] && cnt < 127) { ++cnt; }
+		uint32_t cnt = RLE_RUN(data, i, Length, sse2);
 
 		if (cnt > 1) {
 			outdata[idx++] = uint8_t(cnt);
@@ -55,10 +133,10 @@ RLE_RESULT RLE_ENCODE(uint8_t* data, uint32_t Length, uint8_t* &outdata, uint32_
 			i += cnt;
 		}
 		else {
-			cnt = 0;
-			while (i + cnt < Length && (i + cnt + 1 >= Length || data[i + cnt] != data[i + cnt + 1]) && cnt < 127) { ++cnt; }
+			cnt = RLE_LITERAL(data, i, Length, sse2);
 			outdata[idx++] = uint8_t(-cnt);
-			for (uint32_t j = 0; j < cnt; ++j) { outdata[idx++] = data[i + j]; }
+			memcpy(outdata + idx, data + i, cnt);
+			idx += cnt;
 			i += cnt;
 		}
 	}
@@ -67,10 +145,45 @@ RLE_RESULT RLE_ENCODE(uint8_t* data, uint32_t Length, uint8_t* &outdata, uint32_
 }
 
 
-RLE_RESULT RLE_DECODE(uint8_t* data, uint32_t Length, uint8_t* &outdata, uint32_t &outLength)
+RLE_RESULT RLE_DECODE(const uint8_t* data, uint32_t Length, uint8_t* &outdata, uint32_t &outLength)
+{
+    if (data == NULL || outdata == NULL  || Length <= 0 ) { return RLE_RESULT::RLE_ERROR_INVALID_PARAM; }
+
+	uint32_t idx = 0;
+	uint32_t i = 0;
+
+	while (i < Length) {
+		int8_t cnt = int8_t(data[i++]);
+
+		//Long tokens go through memset/memcpy, a call does not pay off for short ones
+		if (cnt > 0) {
+			const uint32_t n = uint32_t(cnt);
+			if (n >= 16)	{ memset(outdata + idx, data[i], n); idx += n; }
+			else			{ for (uint32_t j = 0; j < n; ++j) { outdata[idx++] = data[i]; } }
+			++i;
+		}
+		else {
+			const uint32_t n = uint32_t(-cnt);
+			if (n >= 16)	{ memcpy(outdata + idx, data + i, n); idx += n; i += n; }
+			else			{ for (uint32_t j = 0; j < n; ++j) { outdata[idx++] = data[i++]; } }
+		}
+	}
+	outLength = idx;
+	return RLE_RESULT::RLE_OK;
+}
+
+
+RLE_RESULT RLE_DECODE_SAFE(const uint8_t* data, uint32_t Length, uint8_t* &outdata, uint32_t &outLength, uint32_t capacity)
 {
     if (data == NULL || outdata == NULL  || Length <= 0 ) { return RLE_RESULT::RLE_ERROR_INVALID_PARAM; }
 
+	//--------------------------------------------------------------//
+	//Every token is checked against both buffers before it is
+	//written, decoding stops at the first one that does not fit.
+	//Short tokens are written with one 16 byte store while the
+	//output has room for it, bytes past the token are scratch.
+	//--------------------------------------------------------------//
+
 	uint32_t idx = 0;
 	uint32_t i = 0;
 
@@ -78,13 +191,22 @@ RLE_RESULT RLE_DECODE(uint8_t* data, uint32_t Length, uint8_t* &outdata, uint32_
 		int8_t cnt = int8_t(data[i++]);
 
 		if (cnt > 0) {
-			for (uint32_t j = 0; j < uint32_t(cnt); ++j) { outdata[idx++] = data[i]; }
+			const uint32_t n = uint32_t(cnt);
+			if (i >= Length || n > capacity - idx) { outLength = idx; return RLE_RESULT::RLE_ERROR_DATA; }
+
+			if (n <= 16 && capacity - idx >= 16)	{ memset(outdata + idx, data[i], 16); }
+			else									{ memset(outdata + idx, data[i], n); }
+			idx += n;
 			++i;
 		}
 		else {
-			for (uint32_t j = 0; j < uint32_t(-cnt); ++j) {
-				outdata[idx++] = data[i++];
-			}
+			const uint32_t n = uint32_t(-cnt);
+			if (n > Length - i || n > capacity - idx) { outLength = idx; return RLE_RESULT::RLE_ERROR_DATA; }
+
+			if (n <= 16 && capacity - idx >= 16 && Length - i >= 16)	{ memcpy(outdata + idx, data + i, 16); }
+			else														{ memcpy(outdata + idx, data + i, n); }
+			idx += n;
+			i += n;
 		}
 	}
 	outLength = idx;
@@ -54,8 +54,9 @@ extern "C" {
 
 	extern uint32_t     SLDD_VERSION	();
 
+	extern SLDD_RESULT  SLDD_SIZE_CALC	(const uint8_t* buffer, uint32_t size, uint32_t& sizecomp);
 	extern SLDD_RESULT  SLDD_ENCODE		(uint8_t* buffer, uint32_t size, uint8_t* &buffercomp, uint32_t& sizecomp);
-	extern SLDD_RESULT  SLDD_DECODE		(uint8_t* buffer, uint32_t size, uint8_t* &bufferde, uint32_t& sizede);
+	extern SLDD_RESULT  SLDD_DECODE		(const uint8_t* buffer, uint32_t size, uint8_t* &bufferde, uint32_t& sizede);
 
 
 
@@ -66,75 +67,300 @@ extern "C" {
 
 #ifdef SLEP_SLDD_IMP
 
+#include "./BITIO.h"
+#include "./CPUID.h"
+
 uint32_t SLDD_VERSION(){ return SLDD_VER; }
 
 
-SLDD_RESULT SLDD_ENCODE(uint8_t* buffer, uint32_t size, uint8_t* &buffercomp, uint32_t& sizecomp) {
+#if CPU_X64
 
-    if (buffer == NULL || buffercomp == NULL  || size <= 0) { return SLDD_RESULT::SLDD_ERROR_INVALID_PARAM; }
+//OR and AND of every byte, 16 bytes per step. Returns the count of bytes folded.
+static uint32_t SLDD_SPAN_SSE2(const uint8_t* buffer, uint32_t size, uint8_t& any, uint8_t& all) {
+
+	__m128i vor		= _mm_setzero_si128();
+	__m128i vand	= _mm_set1_epi8((char)0xFF);
+	uint32_t i		= 0;
+
+	for (; i + 0x10u <= size; i += 0x10u) {
+		const __m128i x = _mm_loadu_si128((const __m128i*)(buffer + i));
+		vor		= _mm_or_si128(vor, x);
+		vand	= _mm_and_si128(vand, x);
+	}
+
+	alignas(16) uint8_t o[16];
+	alignas(16) uint8_t a[16];
+	_mm_store_si128((__m128i*)o, vor);
+	_mm_store_si128((__m128i*)a, vand);
+
+	for (uint32_t j = 0; j < 0x10u; ++j) {
+		any |= o[j];
+		all &= a[j];
+	}
+
+	return i;
+}
+
+
+CPU_TARGET("avx2") static uint32_t SLDD_SPAN_AVX2(const uint8_t* buffer, uint32_t size, uint8_t& any, uint8_t& all) {
+
+	__m256i vor		= _mm256_setzero_si256();
+	__m256i vand	= _mm256_set1_epi8((char)0xFF);
+	uint32_t i		= 0;
+
+	for (; i + 0x20u <= size; i += 0x20u) {
+		const __m256i x = _mm256_loadu_si256((const __m256i*)(buffer + i));
+		vor		= _mm256_or_si256(vor, x);
+		vand	= _mm256_and_si256(vand, x);
+	}
+
+	alignas(32) uint8_t o[32];
+	alignas(32) uint8_t a[32];
+	_mm256_store_si256((__m256i*)o, vor);
+	_mm256_store_si256((__m256i*)a, vand);
+
+	for (uint32_t j = 0; j < 0x20u; ++j) {
+		any |= o[j];
+		all &= a[j];
+	}
+
+	return i;
+}
+
+
+//Packs the width bits above rightCount of 16 bytes per step. Three merge
+//stages join neighbours into 16, 32 and 64-bit lanes, each lane then
+//holds the stream bits of eight bytes. Returns the count of bytes packed.
+static uint32_t SLDD_PACK_SSE2(BIT_WRITER& w, const uint8_t* buffer, uint32_t size, uint32_t rightCount, uint32_t width) {
+
+	const __m128i keep	= _mm_set1_epi8((char)((1u << width) - 1u));
+	const __m128i m16	= _mm_set1_epi16(0x00FF);
+	const __m128i m32	= _mm_set1_epi32(0xFFFF);
+	const __m128i m64	= _mm_set1_epi64x(0xFFFFFFFFll);
+	const __m128i sr	= _mm_cvtsi32_si128((int)rightCount);
+	const __m128i s1	= _mm_cvtsi32_si128((int)width);
+	const __m128i s2	= _mm_cvtsi32_si128((int)width * 2);
+	const __m128i s4	= _mm_cvtsi32_si128((int)width * 4);
+	uint32_t i			= 0;
+
+	for (; i + 0x10u <= size; i += 0x10u) {
+		__m128i x = _mm_loadu_si128((const __m128i*)(buffer + i));
+
+		x = _mm_and_si128(_mm_srl_epi16(x, sr), keep);
+		x = _mm_or_si128(_mm_sll_epi16(_mm_and_si128(x, m16), s1), _mm_srli_epi16(x, 8));
+		x = _mm_or_si128(_mm_sll_epi32(_mm_and_si128(x, m32), s2), _mm_srli_epi32(x, 16));
+		x = _mm_or_si128(_mm_sll_epi64(_mm_and_si128(x, m64), s4), _mm_srli_epi64(x, 32));
+
+		BIT_PUT64(w, (uint64_t)_mm_cvtsi128_si64(x), width * 0x08u);
+		BIT_PUT64(w, (uint64_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(x, x)), width * 0x08u);
+	}
+
+	return i;
+}
+
+
+CPU_TARGET("avx2") static uint32_t SLDD_PACK_AVX2(BIT_WRITER& w, const uint8_t* buffer, uint32_t size, uint32_t rightCount, uint32_t width) {
+
+	const __m256i keep	= _mm256_set1_epi8((char)((1u << width) - 1u));
+	const __m256i m16	= _mm256_set1_epi16(0x00FF);
+	const __m256i m32	= _mm256_set1_epi32(0xFFFF);
+	const __m256i m64	= _mm256_set1_epi64x(0xFFFFFFFFll);
+	const __m128i sr	= _mm_cvtsi32_si128((int)rightCount);
+	const __m128i s1	= _mm_cvtsi32_si128((int)width);
+	const __m128i s2	= _mm_cvtsi32_si128((int)width * 2);
+	const __m128i s4	= _mm_cvtsi32_si128((int)width * 4);
+	uint32_t i			= 0;
+
+	alignas(32) uint64_t lane[4];
+
+	for (; i + 0x20u <= size; i += 0x20u) {
+		__m256i x = _mm256_loadu_si256((const __m256i*)(buffer + i));
+
+		x = _mm256_and_si256(_mm256_srl_epi16(x, sr), keep);
+		x = _mm256_or_si256(_mm256_sll_epi16(_mm256_and_si256(x, m16), s1), _mm256_srli_epi16(x, 8));
+		x = _mm256_or_si256(_mm256_sll_epi32(_mm256_and_si256(x, m32), s2), _mm256_srli_epi32(x, 16));
+		x = _mm256_or_si256(_mm256_sll_epi64(_mm256_and_si256(x, m64), s4), _mm256_srli_epi64(x, 32));
+
+		_mm256_store_si256((__m256i*)lane, x);
+		for (uint32_t j = 0; j < 4; ++j) { BIT_PUT64(w, lane[j], width * 0x08u); }
+	}
+
+	return i;
+}
+
+
+//Inverse of SLDD_PACK_SSE2, the merge stages run backwards. Returns the count of bytes written.
+static uint32_t SLDD_UNPACK_SSE2(BIT_READER& r, uint8_t* bufferde, uint32_t sizede, uint8_t chr, uint32_t rightCount, uint32_t width) {
+
+	const __m128i vchr	= _mm_set1_epi8((char)chr);
+	const __m128i m1	= _mm_set1_epi16((short)((1u << width) - 1u));
+	const __m128i m2	= _mm_set1_epi32((int)((1u << (width * 2)) - 1u));
+	const __m128i m4	= _mm_set1_epi64x((long long)((1ull << (width * 4)) - 1u));
+	const __m128i sr	= _mm_cvtsi32_si128((int)rightCount);
+	const __m128i s1	= _mm_cvtsi32_si128((int)width);
+	const __m128i s2	= _mm_cvtsi32_si128((int)width * 2);
+	const __m128i s4	= _mm_cvtsi32_si128((int)width * 4);
+	uint32_t i			= 0;
+
+	for (; i + 0x10u <= sizede; i += 0x10u) {
+		const uint64_t v0 = BIT_GET64(r, width * 0x08u);
+		const uint64_t v1 = BIT_GET64(r, width * 0x08u);
+		__m128i x = _mm_set_epi64x((long long)v1, (long long)v0);
+
+		x = _mm_or_si128(_mm_srl_epi64(x, s4), _mm_slli_epi64(_mm_and_si128(x, m4), 32));
+		x = _mm_or_si128(_mm_srl_epi32(x, s2), _mm_slli_epi32(_mm_and_si128(x, m2), 16));
+		x = _mm_or_si128(_mm_srl_epi16(x, s1), _mm_slli_epi16(_mm_and_si128(x, m1), 8));
+		x = _mm_or_si128(_mm_sll_epi16(x, sr), vchr);
+
+		_mm_storeu_si128((__m128i*)(bufferde + i), x);
+	}
+
+	return i;
+}
+
+
+CPU_TARGET("avx2") static uint32_t SLDD_UNPACK_AVX2(BIT_READER& r, uint8_t* bufferde, uint32_t sizede, uint8_t chr, uint32_t rightCount, uint32_t width) {
+
+	const __m256i vchr	= _mm256_set1_epi8((char)chr);
+	const __m256i m1	= _mm256_set1_epi16((short)((1u << width) - 1u));
+	const __m256i m2	= _mm256_set1_epi32((int)((1u << (width * 2)) - 1u));
+	const __m256i m4	= _mm256_set1_epi64x((long long)((1ull << (width * 4)) - 1u));
+	const __m128i sr	= _mm_cvtsi32_si128((int)rightCount);
+	const __m128i s1	= _mm_cvtsi32_si128((int)width);
+	const __m128i s2	= _mm_cvtsi32_si128((int)width * 2);
+	const __m128i s4	= _mm_cvtsi32_si128((int)width * 4);
+	uint32_t i			= 0;
 
+	for (; i + 0x20u <= sizede; i += 0x20u) {
+		const uint64_t v0 = BIT_GET64(r, width * 0x08u);
+		const uint64_t v1 = BIT_GET64(r, width * 0x08u);
+		const uint64_t v2 = BIT_GET64(r, width * 0x08u);
+		const uint64_t v3 = BIT_GET64(r, width * 0x08u);
+		__m256i x = _mm256_set_epi64x((long long)v3, (long long)v2, (long long)v1, (long long)v0);
+
+		x = _mm256_or_si256(_mm256_srl_epi64(x, s4), _mm256_slli_epi64(_mm256_and_si256(x, m4), 32));
+		x = _mm256_or_si256(_mm256_srl_epi32(x, s2), _mm256_slli_epi32(_mm256_and_si256(x, m2), 16));
+		x = _mm256_or_si256(_mm256_srl_epi16(x, s1), _mm256_slli_epi16(_mm256_and_si256(x, m1), 8));
+		x = _mm256_or_si256(_mm256_sll_epi16(x, sr), vchr);
+
+		_mm256_storeu_si256((__m256i*)(bufferde + i), x);
+	}
+
+	return i;
+}
+
+#endif // CPU_X64
+
+
+static void SLDD_ANALYZE(const uint8_t* buffer, uint32_t size, int& leftCount, int& rightCount, bool& leftc, bool& rightc) {
 
-	uint8_t* pstr		= buffercomp + 0x01u;
 	const uint8_t first = *buffer;
-	const uint8_t* end	= buffer + size;
-
-	int leftCount			= 0x07u;
-	int rightCount			= 0x07u;
-	const bool leftc		= (first >> 7)	& 0x1u;
-	const bool rightc		= first			& 0x1u;
-
-    for (uint8_t* p = buffer; p != end; ++p) {
-        const uint8_t cur = *p;
-
-        int left_c= 0;
-        int right_c = 0;
-        bool left_open = true;
-        bool right_open = true;
-
-		uint8_t bitLm = 0x80u;
-		uint8_t bitRm = 0x01u;
-
-		while (bitLm != 0u) {
-			bool bitL = (cur & bitLm);
-			bool bitR = (cur & bitRm);
-
-			bitLm >>= 1;
-			bitRm <<= 1;
-
-			if (left_open) {if (bitL == leftc){++left_c;}else{left_open = false;}}
-            if (right_open) {if (bitR == rightc){++right_c;}else{right_open = false;}}
-            
-		}
-        if (left_c < leftCount)  {leftCount = left_c;}
-        if (right_c < rightCount) {rightCount = right_c;}
-        if (leftCount == 0 && rightCount == 0) {break;}
-    }
 
+	leftc					= (first >> 7)	& 0x1u;
+	rightc					= first			& 0x1u;
+
+	//A bit column matches a constant edge when it is set in every byte
+	//or in none, so both runs follow from the OR and AND of all bytes
+	uint8_t any				= 0x00u;
+	uint8_t all				= 0xFFu;
+	uint32_t i				= 0;
+
+#if CPU_X64
+	const uint32_t cpu = CPU_FEATURES();
+	if (cpu & CPU_AVX2) { i = SLDD_SPAN_AVX2(buffer, size, any, all); }
+	if (cpu & CPU_SSE2) { i += SLDD_SPAN_SSE2(buffer + i, size - i, any, all); }
+#endif
+
+	for (; i < size; ++i) {
+		any |= buffer[i];
+		all &= buffer[i];
+	}
+
+	const uint8_t leftd		= leftc ? (uint8_t)~all : any;
+	const uint8_t rightd	= rightc ? (uint8_t)~all : any;
+
+	leftCount				= 0;
+	rightCount				= 0;
+
+	while (leftCount < 0x07 && !(leftd & (0x80u >> leftCount))) { ++leftCount; }
+	while (rightCount < 0x07 && !(rightd & (0x01u << rightCount))) { ++rightCount; }
 
     if (leftCount + rightCount > 8) {
         rightCount -= leftCount + rightCount - 8;
         if (rightCount < 0) {rightCount = 0;}
     }
+}
+
+
+SLDD_RESULT SLDD_SIZE_CALC(const uint8_t* buffer, uint32_t size, uint32_t& sizecomp) {
 
+    if (buffer == NULL || size <= 0) { return SLDD_RESULT::SLDD_ERROR_INVALID_PARAM; }
 
-	uint32_t total 	= size * (0x08u - leftCount - rightCount);
-	sizecomp 		= (total + 0x0Fu) >> 0x03u;
+	int leftCount	= 0;
+	int rightCount	= 0;
+	bool leftc		= false;
+	bool rightc		= false;
+
+	SLDD_ANALYZE(buffer, size, leftCount, rightCount, leftc, rightc);
+
+	const uint32_t width	= 0x08u - leftCount - rightCount;
+	const uint32_t middle	= (0xFFu >> leftCount) & (0xFFu << rightCount) & 0xFFu;
+
+	//Only the header survives the tails remover when no kept bit is set
+	sizecomp = 1;
+
+	for (uint32_t i = size; width > 0 && i > 0; --i) {
+		const uint32_t bits = buffer[i - 1] & middle;
+		if (bits == 0) { continue; }
+
+		//Position of the last set bit in the packed stream
+		uint32_t step = (i - 1) * width;
+		for (uint32_t bit = (0x80u >> leftCount); bit > (bits & (0u - bits)); bit >>= 0x01u) { ++step; }
+
+		sizecomp = 0x02u + (step >> 0x03u);
+		break;
+	}
+
+    return SLDD_RESULT::SLDD_OK;
+}
+
+
+SLDD_RESULT SLDD_ENCODE(uint8_t* buffer, uint32_t size, uint8_t* &buffercomp, uint32_t& sizecomp) {
+
+    if (buffer == NULL || buffercomp == NULL  || size <= 0) { return SLDD_RESULT::SLDD_ERROR_INVALID_PARAM; }
+
+
+	int leftCount		= 0;
+	int rightCount		= 0;
+	bool leftc			= false;
+	bool rightc			= false;
+
+	SLDD_ANALYZE(buffer, size, leftCount, rightCount, leftc, rightc);
+
+	const uint32_t width	= 0x08u - leftCount - rightCount;
+	const uint32_t middle	= (1u << width) - 1u;
 
 	*buffercomp		= (leftCount << 5) | (rightCount << 2) | (leftc << 1) | rightc;
 
-	uint8_t mstart 	= (0x80u >> leftCount);
-	uint8_t mend 	= (0x80u >> (8 - rightCount));
-	uint32_t step 	= 0;
-	
-	for (uint8_t* p = buffer, *c = pstr; p < end; ++p) {
-		for (uint8_t bit = mstart; bit > mend; bit >>= 0x01u) {
-			if (*p & bit) {
-				c = pstr + (step >> 0x03u);
-				*c |= (0x80u >> (step & 0x07u));
-			}
-			++step;
-		}
+	BIT_WRITER w;
+	BIT_WRITER_INIT(w, buffercomp + 0x01u);
+
+	uint32_t i = 0;
+
+#if CPU_X64
+	if (width > 0) {
+		const uint32_t cpu = CPU_FEATURES();
+		if (cpu & CPU_AVX2) { i = SLDD_PACK_AVX2(w, buffer, size, rightCount, width); }
+		if (cpu & CPU_SSE2) { i += SLDD_PACK_SSE2(w, buffer + i, size - i, rightCount, width); }
+	}
+#endif
+
+	for (; i < size; ++i) {
+		BIT_PUT(w, (buffer[i] >> rightCount) & middle, width);
 	}
+
+	sizecomp = uint32_t(BIT_FLUSH(w) - buffercomp);
+
 	//Tails remover
 	while (sizecomp > 1 && buffercomp[sizecomp - 1] == 0) {
 		--sizecomp;
@@ -146,35 +372,39 @@ SLDD_RESULT SLDD_ENCODE(uint8_t* buffer, uint32_t size, uint8_t* &buffercomp, ui
 
 
 
-SLDD_RESULT SLDD_DECODE(uint8_t* buffer, uint32_t size, uint8_t* &bufferde, uint32_t& sizede) {
+SLDD_RESULT SLDD_DECODE(const uint8_t* buffer, uint32_t size, uint8_t* &bufferde, uint32_t& sizede) {
 
     if (buffer == NULL || bufferde == NULL  || size <= 0 ) { return SLDD_RESULT::SLDD_ERROR_INVALID_PARAM; }
 
-	uint8_t* pstr			= buffer + 0x01u;
-	uint8_t DataByte		= *buffer;
-	const uint8_t* endd 	= bufferde + sizede;
-	const uint8_t* endp 	= buffer + size;
+	const uint8_t DataByte	= *buffer;
 
-	uint32_t leftCount		= (DataByte >> 5)	& 0x7u;
-	uint32_t rightCount		= (DataByte >> 2)	& 0x7u;
-	const bool leftc		= (DataByte >> 1)	& 0x1u;
-	const bool rightc		= DataByte			& 0x1u;
+	const uint32_t leftCount	= (DataByte >> 5)	& 0x7u;
+	const uint32_t rightCount	= (DataByte >> 2)	& 0x7u;
+	const bool leftc			= (DataByte >> 1)	& 0x1u;
+	const bool rightc			= DataByte			& 0x1u;
+	const uint32_t width		= (leftCount + rightCount < 0x08u) ? 0x08u - leftCount - rightCount : 0x00u;
 
-	uint8_t mstart 			= (0x80u >> leftCount);
-	uint8_t mend 			= (0x80u >> (8 - rightCount));
 	uint8_t  chr			= 0x00u;
 
 	if (leftCount > 0 && leftc)  {chr |= ((uint8_t)((1u << leftCount) - 1u)) << (8 - leftCount);}
     if (rightCount > 0 && rightc) {chr |= ((uint8_t)((1u << rightCount) - 1u));}
 
-	uint32_t step = 0;
-//&& p < endp error!
-	for (uint8_t* d = bufferde, *p = pstr; d < endd; ++d) {
-		*d = chr;
-		for (uint8_t bit = mstart; bit > mend && p < endp; bit >>= 0x01u) {
-				if (*p & (0x80u >> (step & 0x07u))) { *d |= bit; }
-				p = pstr + (++step >> 0x03u);
-		}
+	//Bits past the end of the data read as zeros and leave chr alone
+	BIT_READER r;
+	BIT_READER_INIT(r, buffer + 0x01u, size - 0x01u);
+
+	uint32_t i = 0;
+
+#if CPU_X64
+	if (width > 0) {
+		const uint32_t cpu = CPU_FEATURES();
+		if (cpu & CPU_AVX2) { i = SLDD_UNPACK_AVX2(r, bufferde, sizede, chr, rightCount, width); }
+		if (cpu & CPU_SSE2) { i += SLDD_UNPACK_SSE2(r, bufferde + i, sizede - i, chr, rightCount, width); }
+	}
+#endif
+
+	for (; i < sizede; ++i) {
+		bufferde[i] = chr | (uint8_t)(BIT_GET(r, width) << rightCount);
 	}
 
     return SLDD_RESULT::SLDD_OK;
@@ -0,0 +1,151 @@
+#ifndef MINI_POOL_H
+#define MINI_POOL_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool. Every worker owns a queue of task numbers,
+// takes work from its front and steals from the back of other queues
+// once its own queue is empty. The calling thread works as worker 0.
+class MiniPool {
+public:
+    typedef std::function<void(uint32_t task, uint32_t worker)> Job;
+
+private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<uint32_t> tasks;
+    };
+
+    std::vector<std::thread> workers_;
+    std::vector<std::unique_ptr<Queue>> queues_;
+
+    std::mutex lock_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+
+    const Job* job_ = nullptr;
+    uint64_t generation_ = 0;
+    uint32_t active_ = 0;
+    bool stop_ = false;
+
+    bool pop(uint32_t worker, uint32_t& task) {
+        {
+            Queue& own = *queues_[worker];
+            std::lock_guard<std::mutex> guard(own.lock);
+            if (!own.tasks.empty()) {
+                task = own.tasks.front();
+                own.tasks.pop_front();
+                return true;
+            }
+        }
+
+        const uint32_t count = (uint32_t)queues_.size();
+
+        for (uint32_t i = 1; i < count; ++i) {
+            Queue& other = *queues_[(worker + i) % count];
+            std::lock_guard<std::mutex> guard(other.lock);
+            if (!other.tasks.empty()) {
+                task = other.tasks.back();
+                other.tasks.pop_back();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void work(uint32_t worker, const Job& job) {
+        uint32_t task = 0;
+        while (pop(worker, task)) {
+            job(task, worker);
+        }
+    }
+
+    void loop(uint32_t worker) {
+        uint64_t seen = 0;
+
+        for (;;) {
+            const Job* job = nullptr;
+            {
+                std::unique_lock<std::mutex> guard(lock_);
+                wake_.wait(guard, [&] { return stop_ || generation_ != seen; });
+                if (stop_) { return; }
+                seen = generation_;
+                job = job_;
+            }
+
+            work(worker, *job);
+
+            std::lock_guard<std::mutex> guard(lock_);
+            if (--active_ == 0) { done_.notify_one(); }
+        }
+    }
+
+public:
+    explicit MiniPool(unsigned threads = 0) {
+        if (threads == 0) { threads = std::thread::hardware_concurrency(); }
+        if (threads == 0) { threads = 1; }
+
+        for (unsigned i = 0; i < threads; ++i) {
+            queues_.emplace_back(new Queue());
+        }
+        for (unsigned i = 1; i < threads; ++i) {
+            workers_.emplace_back(&MiniPool::loop, this, i);
+        }
+    }
+
+    ~MiniPool() {
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (std::thread& t : workers_) { t.join(); }
+    }
+
+    MiniPool(const MiniPool&) = delete;
+    MiniPool& operator=(const MiniPool&) = delete;
+
+    uint32_t size() const { return (uint32_t)queues_.size(); }
+
+    // Runs job for every task in [0, count) and returns when all are done.
+    // Each worker starts with a contiguous range of tasks.
+    void run(uint32_t count, const Job& job) {
+        const uint32_t threads = size();
+
+        for (uint32_t w = 0; w < threads; ++w) {
+            const uint32_t first = (uint32_t)((uint64_t)count * w / threads);
+            const uint32_t last  = (uint32_t)((uint64_t)count * (w + 1) / threads);
+
+            std::lock_guard<std::mutex> guard(queues_[w]->lock);
+            for (uint32_t t = first; t < last; ++t) {
+                queues_[w]->tasks.push_back(t);
+            }
+        }
+
+        if (threads > 1) {
+            std::lock_guard<std::mutex> guard(lock_);
+            job_ = &job;
+            active_ = threads - 1;
+            ++generation_;
+        }
+        wake_.notify_all();
+
+        work(0, job);
+
+        if (threads > 1) {
+            std::unique_lock<std::mutex> guard(lock_);
+            done_.wait(guard, [&] { return active_ == 0; });
+            job_ = nullptr;
+        }
+    }
+};
+
+#endif // MINI_POOL_H
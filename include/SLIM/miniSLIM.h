@@ -1,6 +1,6 @@
 // SPDX-License-Identifier: MIT
 // SLIM (Sleptsov Image format) for C/C++
-// Version: 1.2.0.0
+// Version: 1.3.0.0
 // Copyright (C) 2026 Sleptsov Vladimir 
 // https://github.com/VERTEXSoftware
 
@@ -10,10 +10,17 @@
 #include <cmath>
 #include <cstdio>
 #include <cstdint>
+#include <cstddef>
 #include <fstream>
 #include <cstring>
 #include <algorithm>
+#include <functional>
+#include <mutex>
+#include <memory>
+#include <new>
+#include <vector>
 #include "./miniStream.h"
+#include "./miniPool.h"
 
 #define SLEP_SLDD_IMP
 #define SLEP_MASKARED_IMP
@@ -29,12 +36,21 @@
 #define MINI_SLIM_HEADER 		"miniSLIM"
 
 #define SLIM_VER_MAJOR 1
-#define SLIM_VER_MINOR 2
+#define SLIM_VER_MINOR 3
 #define SLIM_VER_BUGFIX 0
 #define SLIM_VER_HOTFIX 0
 
 #define SLIM_VER ((SLIM_VER_MAJOR << 24) | (SLIM_VER_MINOR << 16) | (SLIM_VER_BUGFIX << 8) | (SLIM_VER_HOTFIX))
 
+//Oldest version that can still be read (1.2.0.0, no flags)
+#define SLIM_VER_MIN ((1 << 24) | (2 << 16) | (0 << 8) | (0))
+
+#define SLIM_CHUNK_INDEX		0x58444953u	//"SIDX"
+#define SLIM_CHUNK_MIP			0x50494D53u	//"SMIP"
+#define SLIM_CHUNK_STATS		0x41545353u	//"SSTA"
+
+#define SLIM_BLOCK_MAX			(2u + 5u + 5u * 256u)	//meta + sizes + payloads
+
 #if defined(SLIM_MALLOC) && defined(SLIM_FREE)
 // ok
 #elif !defined(SLIM_MALLOC) && !defined(SLIM_FREE)
@@ -83,6 +99,40 @@ enum	SLIMFILTER {
 
 };
 
+enum	SLIMFLAG {
+		FLAG_NONE			= 0x0,
+		FLAG_INDEX			= 0x1,
+		FLAG_RESTART		= 0x2,
+		FLAG_MIP			= 0x4,
+		FLAG_LAYERS			= 0x8,
+		FLAG_STATS			= 0x10
+};
+
+#define SLIM_FLAG_MASK		(FLAG_INDEX | FLAG_RESTART | FLAG_MIP | FLAG_LAYERS | FLAG_STATS)
+
+//Restart the reuse chain at every block row
+#define SLIM_RESTART_ROW	0xFFFFFFFFu
+
+//Store MIP levels down to 1x1
+#define SLIM_MIP_FULL		0xFFFFFFFFu
+
+//Encoder effort, 0 is the fastest and 7 the smallest output
+#define SLIM_EFFORT_DEFAULT	4
+#define SLIM_EFFORT_MAX		7
+
+//Codecs the revolver may pick, the original bytes always qualify
+#define SLIM_CODEC_RLE		0x1
+#define SLIM_CODEC_RICE		0x2
+#define SLIM_CODEC_SLDD		0x4
+#define SLIM_CODEC_MASKARED	0x8
+#define SLIM_CODEC_ALL		(SLIM_CODEC_RLE | SLIM_CODEC_RICE | SLIM_CODEC_SLDD | SLIM_CODEC_MASKARED)
+#define SLIM_CODEC_RICE_EXACT	0x10	//RICE prices every k instead of taking it from the mean
+
+//Palette orders the encoder may try, any order decodes the same
+#define SLIM_ORDER_SORTED	0x1
+#define SLIM_ORDER_FREQUENT	0x2
+#define SLIM_ORDER_FIRST	0x4
+
 enum	SLIMCODE {
 		CODE_NONE			= 0x0,
 		CODE_RGB			= 0x3,
@@ -98,8 +148,17 @@ struct		SLIM_INFO {
 	uint8_t					_CODE;	
 	uint8_t					_FILTER;
 	uint8_t					_LEVEL;
+	uint8_t					_FLAGS;
+
+	uint32_t				_RESTART;	//Blocks per restart interval, stored only with FLAG_RESTART
+	uint32_t				_MIPS;		//MIP levels after the base image, stored only with FLAG_MIP
+	uint32_t				_LAYERS;	//Entries in the layer directory, stored only with FLAG_LAYERS
+	uint8_t					_EFFORT;	//Encoder effort, not stored
 };
 
+//Size of the fixed part of the header in the file
+#define SLIM_INFO_SIZE		offsetof(SLIM_INFO, _RESTART)
+
 struct		SLIM_INFO_FULL {
 
 	uint32_t				_VERS;
@@ -108,6 +167,10 @@ struct		SLIM_INFO_FULL {
 	uint8_t					_CODE;	
 	uint8_t					_FILTER;
 	uint8_t					_LEVEL;
+	uint8_t					_FLAGS;
+	uint32_t				_RESTART;
+	uint32_t				_MIPS;
+	uint32_t				_LAYERS;
 
 	uint32_t 				_BLOCK_256_ALL;
 	uint32_t 				_BLOCK_256_EXIST;
@@ -129,26 +192,103 @@ struct		SLIM_INFO_FULL {
 	uint32_t				_SLDD_C;
 	uint32_t				_MASKARED_C;
 
+	int64_t					_RESTART_COST;	//Bytes added by restarts (encoder only)
+};
+
+//Tail chunk trailer, written after the chunk payload
+struct		SLIM_CHUNK {
+
+	uint32_t				_TAG;
+	uint32_t				_SIZE;
 };
 
+struct		SLIM_INDEX {
 
-SLIM_INFO Create_Info(uint16_t w, uint16_t h, uint8_t code = CODE_RGBA, uint8_t filter = FILTER_COLORDIV, uint8_t level = 2);
+	uint32_t				_SEGMENT;	//Blocks per entry
+	uint32_t				_COUNT;		//Entries
+	uint64_t				_BASE;		//Stream position of the first block
+	uint64_t*				_OFFSET;	//Entry offsets from _BASE
+};
+
+//Layer directory entry, the directory follows the file header
+struct		SLIM_LAYER {
+
+	uint16_t				_WIDTH;
+	uint16_t				_HEIGHT;
+	uint8_t					_CODE;
+	uint8_t					_LEVEL;
+	uint16_t				_GROUP;		//Layers of one size share the index layout
+	uint64_t				_OFFSET;	//First block of the layer from the first block of layer 0
+};
+
+struct		SLIM_LAYERS {
+
+	SLIM_INFO				_HEADER;
+	uint32_t				_COUNT;		//Layers
+	uint64_t				_BASE;		//Stream position of the first block of layer 0
+	SLIM_LAYER*				_LAYER;
+	SLIM_INDEX*				_INDEX;		//Per layer, NULL without FLAG_INDEX
+	uint64_t*				_TABLE;		//Index offsets of all layers
+};
+
+//Receives rows [y0, y0 + rows) of the image, ptr is valid only during the call
+typedef std::function<void(uint32_t y0, uint32_t rows, const uint8_t* ptr, size_t stride)> SLIM_STRIP_CALLBACK;
+
+
+SLIM_INFO Create_Info(uint16_t w, uint16_t h, uint8_t code = CODE_RGBA, uint8_t filter = FILTER_COLORDIV, uint8_t level = 2, uint8_t flags = FLAG_INDEX | FLAG_STATS, uint32_t restart = 0, uint32_t mips = 0, uint8_t effort = SLIM_EFFORT_DEFAULT);
 
 SLIMERROR Load_SLIM(MiniStream &infile, SLIM_INFO &header,uint8_t* &img);
 
-SLIMERROR Save_SLIM(MiniStream &outfile, SLIM_INFO &header, uint8_t* &img);
+SLIMERROR Load_SLIM_Parallel(MiniStream &infile, SLIM_INFO &header, uint8_t* &img, unsigned threads = 0);
+
+SLIMERROR Load_SLIM_Strips(MiniStream &infile, SLIM_INFO &header, SLIM_STRIP_CALLBACK on_strip);
+
+SLIMERROR Load_SLIM_Region(MiniStream &infile, SLIM_INFO &header, uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint8_t* out);
+
+SLIMERROR Load_SLIM_Level(MiniStream &infile, SLIM_INFO &header, uint32_t level, uint8_t* &img);
+
+SLIMERROR Save_SLIM(MiniStream &outfile, SLIM_INFO &header, uint8_t* &img, SLIM_INFO_FULL* info = NULL);
+
+SLIMERROR Save_SLIM_Parallel(MiniStream &outfile, SLIM_INFO &header, uint8_t* &img, unsigned threads = 0, SLIM_INFO_FULL* info = NULL);
 
 SLIMERROR Info_SLIM(MiniStream &infile, SLIM_INFO_FULL &info);
 
+SLIMERROR Info_SLIM_Fast(MiniStream &infile, SLIM_INFO_FULL &info);
+
 SLIMERROR Free_Buf(void* buf);
 
 SLIMERROR Load_SLIM_Map(MiniStream &infile, SLIM_INFO &header,uint8_t* &img);
 
 SLIMERROR Load_SLIM_Mini(MiniStream &infile, SLIM_INFO &header,uint8_t* &img);
 
+SLIMERROR Load_SLIM_Scaled(MiniStream &infile, SLIM_INFO &header, uint32_t scale, uint8_t* &img);
+
+SLIMERROR Index_SLIM(MiniStream &infile, SLIM_INFO &header, SLIM_INDEX &index);
+
+SLIMERROR Free_Index(SLIM_INDEX &index);
+
+SLIMERROR Save_SLIM_Layers(MiniStream &outfile, SLIM_INFO &header, SLIM_LAYER* layers, uint8_t** imgs, uint32_t count, unsigned threads = 1);
+
+SLIMERROR Open_SLIM_Layers(MiniStream &infile, SLIM_LAYERS &dir);
+
+SLIMERROR Load_SLIM_Layer(MiniStream &infile, SLIM_LAYERS &dir, uint32_t layer, uint8_t* &img, unsigned threads = 1);
+
+SLIMERROR Free_Layers(SLIM_LAYERS &dir);
+
+//Overloads for concrete stream types, the block loops are compiled
+//against StreamT so final streams are called without virtual dispatch
+
+template<class StreamT> SLIMERROR Load_SLIM(StreamT &infile, SLIM_INFO &header, uint8_t* &img);
+
+template<class StreamT> SLIMERROR Load_SLIM_Parallel(StreamT &infile, SLIM_INFO &header, uint8_t* &img, unsigned threads = 0);
+
+template<class StreamT> SLIMERROR Save_SLIM(StreamT &outfile, SLIM_INFO &header, uint8_t* &img, SLIM_INFO_FULL* info = NULL);
+
+template<class StreamT> SLIMERROR Save_SLIM_Parallel(StreamT &outfile, SLIM_INFO &header, uint8_t* &img, unsigned threads = 0, SLIM_INFO_FULL* info = NULL);
+
 SLIMERROR Free_Buf(void* buf){
 
-	if(buf!=NULL){return SLIMERROR::ERROR_ARG;}
+	if(buf==NULL){return SLIMERROR::ERROR_ARG;}
 
 	SLIM_FREE(buf);
 
@@ -173,577 +313,2406 @@ bool IsOrgLine(uint8_t* a, uint8_t* b, uint32_t count) {
 }
 
 
-void GEN_CLR_MAP_RGB(uint8_t* R, uint8_t* G, uint8_t* B, uint32_t& size, uint8_t* idx, uint32_t pidx, uint8_t cR, uint8_t cG, uint8_t cB) {
-
-	uint32_t pos = 0;
-	uint32_t fnd = ((uint32_t)cR << 16) | ((uint32_t)cG << 8) | (uint32_t)cB;
+void SLIM_INFO_CLEAR(SLIM_INFO_FULL &info, SLIM_INFO &header){
 
-    while (pos < size) {
-        uint32_t cur = ((uint32_t)R[pos] << 16) | ((uint32_t)G[pos] << 8) | (uint32_t)B[pos];
-        
-        if (cur == fnd) {
-            idx[pidx] = pos;
-            return;
-        }
-        if (cur > fnd) {
-            break;
-        }
-        ++pos;
-    }
+	info._VERS 					= header._VERS;
+	info._WIDTH 				= header._WIDTH;
+	info._HEIGHT 				= header._HEIGHT;
+	info._CODE 					= header._CODE;	
+	info._FILTER 				= header._FILTER;
+	info._LEVEL					= header._LEVEL;
+	info._FLAGS					= header._FLAGS;
+	info._RESTART				= header._RESTART;
+	info._MIPS					= header._MIPS;
+	info._LAYERS				= header._LAYERS;
 
-	for (uint32_t i = 0; i < pidx; ++i) {
-		if (idx[i] >= pos) { ++idx[i]; }
-	}
+	info._BLOCK_256_ALL 		= 0;
+	info._BLOCK_256_EXIST		= 0;
+	info._BLOCK_256_EMPTY		= 0;
+	info._BLOCK_COLOR_TABLE_MAX = 0;
+	info._BLOCK_COLOR_TABLE_MIN = 0xFFFFFFFFu;
+	info._BLOCK_COLOR_TABLE_AVG = 0;
 
-	for (uint32_t i = size; i > pos; --i) {
-		R[i] = R[i - 1];
-		G[i] = G[i - 1];
-		B[i] = B[i - 1];
-	}
+	info._BLOCK_Q_MAX		= 0;
+	info._BLOCK_Q_MIN		= 0xFFFFFFFFu;
+	info._BLOCK_Q_AVG		= 0;
+	
+	info._ALL_C					= 0;
+	info._REUSE_C				= 0;
+	info._ORIGINAL_C			= 0;
+	info._RICE_C				= 0;
+	info._RLE_C					= 0;
+	info._SLDD_C				= 0;
+	info._MASKARED_C			= 0;
 
-	R[pos] 		= cR;
-	G[pos] 		= cG;
-	B[pos] 		= cB;
-	idx[pidx] 	= pos;
-	++size;
+	info._RESTART_COST			= 0;
 }
 
-void GEN_CLR_MAP_RGBA(uint8_t* R, uint8_t* G, uint8_t* B, uint8_t* A, uint32_t& size, uint8_t* idx, uint32_t pidx, uint8_t cR, uint8_t cG, uint8_t cB, uint8_t cA) {
 
-	uint32_t pos = 0;
-	uint32_t fnd = ((uint32_t)cR << 24) | ((uint32_t)cG << 16) | ((uint32_t)cB << 8) | (uint32_t)cA;
+void SLIM_INFO_ADD_BLOCK(SLIM_INFO_FULL &info, const uint16_t* comp_pack, uint32_t qnt, uint32_t colors){
 
-    while (pos < size) {
-        uint32_t cur = ((uint32_t)R[pos] << 24) |((uint32_t)G[pos] << 16) | ((uint32_t)B[pos] << 8) | (uint32_t)A[pos];
-        
-        if (cur == fnd) {
-            idx[pidx] = pos;
-            return;
-        }
-        if (cur > fnd) {
-            break;
-        }
-        ++pos;
-    }
+	//colors - palette size, counted only when the index stream is stored
 
-	for (uint32_t i = 0; i < pidx; ++i) {
-		if (idx[i] >= pos) { ++idx[i]; }
+	for(uint8_t i=0; i<5; ++i){
+		info._REUSE_C		+= (comp_pack[i]==0);
+		info._ORIGINAL_C	+= (comp_pack[i]==1);
+		info._RLE_C			+= (comp_pack[i]==2);
+		info._RICE_C		+= (comp_pack[i]==3);
+		info._SLDD_C		+= (comp_pack[i]==4);
+		info._MASKARED_C	+= (comp_pack[i]==5);
 	}
 
-	for (uint32_t i = size; i > pos; --i) {
-		R[i] = R[i - 1];
-		G[i] = G[i - 1];
-		B[i] = B[i - 1];
-		A[i] = A[i - 1];
+	if(comp_pack[0] || comp_pack[1] || comp_pack[2] || comp_pack[3]){
+		if(info._BLOCK_Q_MAX<qnt){info._BLOCK_Q_MAX=qnt;}
+		if(info._BLOCK_Q_MIN>qnt){info._BLOCK_Q_MIN=qnt;}
 	}
 
-	R[pos] 		= cR;
-	G[pos] 		= cG;
-	B[pos] 		= cB;
-	A[pos] 		= cA;
-	idx[pidx] 	= pos;
-	++size;
+	const bool exist = comp_pack[0] || comp_pack[1] || comp_pack[2] || comp_pack[3] || comp_pack[4];
+
+	info._BLOCK_256_ALL++;
+	info._BLOCK_256_EXIST += exist;
+	info._BLOCK_256_EMPTY += !exist;
+	info._BLOCK_Q_AVG += qnt;
 
+	if(comp_pack[4]){
+		//Palette indices start at 0, so the smallest table holds one color
+		if(info._BLOCK_COLOR_TABLE_MIN>1){info._BLOCK_COLOR_TABLE_MIN=1;}
+		if(info._BLOCK_COLOR_TABLE_MAX<colors){info._BLOCK_COLOR_TABLE_MAX=colors;}
+		info._BLOCK_COLOR_TABLE_AVG+=colors;
+	}
 }
 
 
+void SLIM_INFO_FINISH(SLIM_INFO_FULL &info){
+
+	info._ALL_C = info._REUSE_C + info._ORIGINAL_C + info._RLE_C + info._RICE_C + info._SLDD_C + info._MASKARED_C;
+
+	if (info._BLOCK_256_ALL > 0)	{ info._BLOCK_Q_AVG /= info._BLOCK_256_ALL; }
+	if (info._BLOCK_256_EXIST > 0)	{ info._BLOCK_COLOR_TABLE_AVG /= info._BLOCK_256_EXIST; }
+}
 
 
-uint16_t ENCODE_REVOLVER(bool orig, uint8_t* src, uint8_t* dest, uint32_t size, uint32_t &r_size) {
+uint32_t SLIM_PALETTE_DEDUP(const uint32_t* keys, uint32_t count, uint32_t* uniq, uint8_t* ids){
 
 	//--------------------------------------------------------------//
-	//Encode by the revolver method
+	//Unique packed colors in order of first appearance and the id
+	//of every pixel, using an open addressing table
 	//--------------------------------------------------------------//
 
-	if (size <= 0) { return 0; }
-	if (orig==false)  {return 0; }
+	uint16_t table[512];	//Hash slot -> color id, 0xFFFF empty
 
-	uint8_t t_rle      [1024]{ 0 };
-	uint8_t t_rice     [1024]{ 0 };
-    uint8_t t_sldd     [1024]{ 0 };
-    uint8_t t_maskared [1024]{ 0 };
+	memset(table, 0xFF, sizeof(table));
 
-    uint32_t r_size_pack    [5]{size,size,size,size,size};
-    uint8_t* pack           [5]{src, t_rle,t_rice, t_sldd, t_maskared };
+	uint32_t colors = 0;
 
-	uint16_t pos_mode = 0;
+	for (uint32_t p = 0; p < count; ++p)
+	{
+		const uint32_t key = keys[p];
 
-    RLE_ENCODE(src, size, pack[1], r_size_pack[1]);
-	RICE_ENCODE(src, size, pack[2], r_size_pack[2]);
-    SLDD_ENCODE(src, size, pack[3], r_size_pack[3]);
-    MASKARED_ENCODE(src, size, pack[4], r_size_pack[4]);
+		uint32_t slot = (key * 0x9E3779B1u) >> 23;
 
-    for(uint16_t i = 1; i < 5; ++i){
-        if(r_size_pack[pos_mode]>r_size_pack[i]){
-            pos_mode = i;
-        }
-    }
+		while (table[slot] != 0xFFFFu && uniq[table[slot]] != key) { slot = (slot + 1u) & 511u; }
 
-	r_size = r_size_pack[pos_mode];
+		if (table[slot] == 0xFFFFu) {
+			table[slot]		= (uint16_t)colors;
+			uniq[colors]	= key;
+			++colors;
+		}
 
-	uint8_t* d = dest;
-	uint8_t* s = pack[pos_mode];
-	uint8_t* e = s + r_size;
-	while (s < e) {*d++ = *s++;}
+		ids[p] = (uint8_t)table[slot];
+	}
 
-	return pos_mode+1;
+	return colors;
 }
 
 
-
-
-void  DECODE_REVOLVER(uint16_t mode, uint8_t* src, uint8_t* dest, uint32_t size) {
+void SLIM_PALETTE_SORT(const uint32_t* uniq, uint32_t colors, const uint8_t* ids, uint32_t count, uint32_t channels, uint8_t* l_data){
 
 	//--------------------------------------------------------------//
-	//Decode by the revolver method
+	//Sorted palette (R high byte first) and the rank of every pixel
+	//in it, the same result as inserting every pixel into a sorted
+	//list. Sorted once: radix on the packed key, insertion when small.
 	//--------------------------------------------------------------//
 
-	if (size<=0) { return; }
-	if (mode==0)  { return; }
+	uint64_t order	[256];	//key << 8 | color id
+	uint64_t temp	[256];
+	uint8_t  rank	[256];	//Color id -> palette position
 
-	uint32_t r_size = 0;
+	for (uint32_t i = 0; i < colors; ++i) { order[i] = ((uint64_t)uniq[i] << 8) | i; }
 
-	switch (mode)
-	{
-		case 1:
-		{
-			uint8_t* d = dest;
-			uint8_t* s = src;
-			uint8_t* e = s + size;
-			while (s < e) {*d++ = *s++;}
-			break;
-		}	
-		case 2:
-		{
-			RLE_DECODE(src, size, dest, r_size);
-			break;
-		}
-		case 3:
+	if (colors > 32) {
+		//LSD radix sort on the key bytes, bytes shared by every color are skipped
+		const uint32_t passes = (channels == 4) ? 4u : 3u;
+
+		uint64_t* from	= order;
+		uint64_t* to	= temp;
+
+		for (uint32_t pass = 0; pass < passes; ++pass)
 		{
-			r_size = 256;
-			RICE_DECODE(src, size, dest, r_size);
-			break;
+			const uint32_t shift = 8u + pass * 8u;
+
+			uint32_t hist[256]{0};
+
+			for (uint32_t i = 0; i < colors; ++i) { ++hist[(from[i] >> shift) & 0xFFu]; }
+
+			if (hist[(from[0] >> shift) & 0xFFu] == colors) { continue; }
+
+			uint32_t sum = 0;
+
+			for (uint32_t b = 0; b < 256; ++b) { const uint32_t h = hist[b]; hist[b] = sum; sum += h; }
+
+			for (uint32_t i = 0; i < colors; ++i) { to[hist[(from[i] >> shift) & 0xFFu]++] = from[i]; }
+
+			std::swap(from, to);
 		}
-		case 4:
-		{
-			r_size = 256;
-			SLDD_DECODE(src, size, dest, r_size);
-			break;
-		}		
-		case 5:
+
+		if (from != order) { memcpy(order, from, colors * sizeof(uint64_t)); }
+	}
+	else {
+		for (uint32_t i = 1; i < colors; ++i)
 		{
-			r_size = 256;
-			MASKARED_DECODE(src, size, dest, r_size);
-			break;
+			const uint64_t v = order[i];
+
+			uint32_t j = i;
+
+			for (; j > 0 && order[j - 1] > v; --j) { order[j] = order[j - 1]; }
+
+			order[j] = v;
 		}
-		default:
-		{
-			return;
-		}		
 	}
-}
 
+	uint8_t* l_idx = l_data + 256u * channels;
 
-uint32_t BLOCK_ANALYZER(uint8_t level,uint8_t* img, uint32_t m_WIDTH, uint32_t m_HEIGHT, uint32_t blocksX, uint32_t blocksY, uint32_t channels = 3) {
+	for (uint32_t i = 0; i < colors; ++i)
+	{
+		const uint32_t key = (uint32_t)(order[i] >> 8);
 
-	//--------------------------------------------------------------//
-	//Counting unique colors
-	//--------------------------------------------------------------//
+		rank[order[i] & 0xFFu] = (uint8_t)i;
 
-	uint32_t colors[256]{0};
-	uint32_t colorCount = 0;
+		if (channels == 4) {
+			l_data[i]			= (uint8_t)(key >> 24);
+			l_data[i + 256u]	= (uint8_t)(key >> 16);
+			l_data[i + 512u]	= (uint8_t)(key >> 8);
+			l_data[i + 768u]	= (uint8_t)key;
+		}
+		else {
+			l_data[i]			= (uint8_t)(key >> 16);
+			l_data[i + 256u]	= (uint8_t)(key >> 8);
+			l_data[i + 512u]	= (uint8_t)key;
+		}
+	}
 
-    for (uint32_t y = 0; y < 16; ++y)
-    {
-        for (uint32_t x = 0; x < 16; ++x)
-        {
-			uint32_t row    = blocksY + y;
-            uint32_t column = blocksX + x;
+	for (uint32_t p = 0; p < count; ++p) { l_idx[p] = rank[ids[p]]; }
+}
 
-            if (column >= m_WIDTH || row >= m_HEIGHT){continue;}
 
-            uint32_t idx = channels * (row * m_WIDTH + column);
+void SLIM_PALETTE_STORE(const uint32_t* uniq, uint32_t colors, const uint8_t* ids, uint32_t count, uint32_t channels, uint8_t* l_data){
 
-            uint8_t r = channels>0	? img[idx]		:0;
-            uint8_t g = channels>1	? img[idx+1]	:0;
-            uint8_t b = channels>2	? img[idx+2]	:0;
-			uint8_t a = channels>3	? img[idx+3]	:0;
+	//--------------------------------------------------------------//
+	//Palette in order of first appearance, the ids are the indices
+	//--------------------------------------------------------------//
 
-            uint32_t color = (r << 24) | (g << 16) | (b << 8) | a;
-			bool found = false;
+	for (uint32_t i = 0; i < colors; ++i)
+	{
+		const uint32_t key = uniq[i];
 
-			for (uint32_t i = 0; i < colorCount; ++i)
-			{
-				if (colors[i] == color){found = true;break;}
-			}
+		if (channels == 4) {
+			l_data[i]			= (uint8_t)(key >> 24);
+			l_data[i + 256u]	= (uint8_t)(key >> 16);
+			l_data[i + 512u]	= (uint8_t)(key >> 8);
+			l_data[i + 768u]	= (uint8_t)key;
+		}
+		else {
+			l_data[i]			= (uint8_t)(key >> 16);
+			l_data[i + 256u]	= (uint8_t)(key >> 8);
+			l_data[i + 512u]	= (uint8_t)key;
+		}
+	}
 
-			if (!found){colors[colorCount++] = color;}
-        }
-    }
+	memcpy(l_data + 256u * channels, ids, count);
+}
 
-   	uint32_t levelq = colorCount * 0.0274509803;  // (7 / 255)
-	
-	uint32_t count = 0;
-	double sumDiff = 0;
-    const double invLevelq = levelq == 0 ? 1.0 : 1.0 / levelq * 2.0;
-
-	//--------------------------------------------------------------//
-	//PSNR Analysis
-	//--------------------------------------------------------------//
-
-    for (uint32_t y = 0; y < 16; ++y)
-    {
-        for (uint32_t x = 0; x < 16; ++x)
-        {
-            uint32_t column = blocksX + x;
-			uint32_t row    = blocksY + y;
-
-            if (column >= m_WIDTH || row >= m_HEIGHT){continue;}
-
-            uint32_t idx = channels * (row * m_WIDTH + column);
-
-			if(channels>0){ 
-				double c = (double)img[idx]; 
-                double d = c - (c * invLevelq);
-                sumDiff += d * d;
-			} 
-			if(channels>1){ 
-				double c = (double)img[idx+1]; 
-                double d = c - (c * invLevelq);
-                sumDiff += d * d;
-			} 
-			if(channels>2){ 
-				double c = (double)img[idx+2]; 
-                double d = c - (c * invLevelq);
-                sumDiff += d * d;
-			} 
-			if(channels>3){ 
-				double c = (double)img[idx+3]; 
-                double d = c - (c * invLevelq);
-                sumDiff += d * d;
-			}
-            count += channels;
-        }
-    }
 
-	double psnr = 1.0 - (sumDiff / count / 65025.0);
+void SLIM_PALETTE_FREQUENT(const uint32_t* uniq, uint32_t colors, const uint8_t* ids, uint32_t count, uint32_t channels, uint8_t* l_data){
 
 	//--------------------------------------------------------------//
-	//Adjusting the evaluation level and quantization
+	//Palette from the most used color down, ties in order of first
+	//appearance, so the index stream holds mostly small values
 	//--------------------------------------------------------------//
 
-	if (psnr < 0.0){psnr = 0.0;}
-    if (psnr > 1.0){psnr = 1.0;}
-    
-  	const double factor = (255.0 - (double)level) * 0.0156862745; //(4.0 / 255.0)
+	uint32_t hist	[256]{0};	//Color id -> pixels
+	uint32_t start	[257]{0};	//Pixels -> first palette position
+	uint32_t fuq	[256];		//Unique colors by frequency
+	uint8_t  rank	[256];		//Color id -> palette position
+	uint8_t  fid	[256];		//Pixel -> palette position
 
-	uint32_t idxt = levelq * psnr * factor;
-
-	if (idxt > 7){ idxt = 7;}
+	for (uint32_t p = 0; p < count; ++p) { ++hist[ids[p]]; }
+	for (uint32_t i = 0; i < colors; ++i) { ++start[256u - hist[i]]; }
 
-	return idxt;
-}
+	uint32_t sum = 0;
 
+	for (uint32_t b = 0; b < 257; ++b) { const uint32_t h = start[b]; start[b] = sum; sum += h; }
 
+	for (uint32_t i = 0; i < colors; ++i)
+	{
+		const uint32_t pos = start[256u - hist[i]]++;
 
-SLIMERROR SLIM_WRITE_BLOCKS_3CHANNEL(MiniStream &outfile, SLIM_INFO &header, uint8_t* &img){
+		rank[i]		= (uint8_t)pos;
+		fuq[pos]	= uniq[i];
+	}
 
+	for (uint32_t p = 0; p < count; ++p) { fid[p] = rank[ids[p]]; }
 
-	uint32_t m_WIDTH = (uint32_t)header._WIDTH;
-	uint32_t m_HEIGHT = (uint32_t)header._HEIGHT;
+	SLIM_PALETTE_STORE(fuq, colors, fid, count, channels, l_data);
+}
 
-	uint8_t m_data		[1024]{0}; 	//Old		block memory
-	uint8_t l_data		[1024]{0}; 	//Curret	block memory
-	uint8_t m_write		[1024]{0}; 	//Curret	block packed
-	uint8_t m_size		[4]{0};	 	//Size 		blocks packed
 
-	//Pointers old block memory
-	uint8_t* m_ch0 = m_data;
-	uint8_t* m_ch1 = m_data + 256u;
-	uint8_t* m_ch2 = m_data + 512u;
-	uint8_t* m_idx = m_data + 768u;
+//What the encoder spends its time on at one effort level
+struct		SLIM_EFFORT {
 
-	//Pointers curret block memory
-	uint8_t* l_ch0 = l_data;
-	uint8_t* l_ch1 = l_data + 256u;
-	uint8_t* l_ch2 = l_data + 512u;
-	uint8_t* l_idx = l_data + 768u;
+	uint8_t					codecs;		//SLIM_CODEC_* the revolver tries
+	bool					reuse;		//Reuse streams equal to the previous block
+	uint8_t					orders;		//SLIM_ORDER_* tried for the palette, the smallest is kept
+};
 
 
-	for (uint32_t blcY = 0; blcY < m_HEIGHT; blcY += 16)
-	{
-		for (uint32_t blcX = 0; blcX < m_WIDTH; blcX += 16)
-		{
+SLIM_EFFORT SLIM_EFFORT_PLAN(uint8_t effort){
 
-			uint32_t Cout 	= 0;
-			uint32_t CColor = 0;	
-			uint32_t qnt_idx = BLOCK_ANALYZER(header._LEVEL, img, m_WIDTH, m_HEIGHT, blcX, blcY, 3);
-			uint32_t qnt 	= qnt_idx << 1;
+	//--------------------------------------------------------------//
+	//Every level writes a normal stream, only the search differs
+	//--------------------------------------------------------------//
 
-			for (uint32_t y = 0; y < 16; ++y)
-			{
-				for (uint32_t x = 0; x < 16; ++x)
-				{
-					uint32_t column		= blcX + x;
-					uint32_t row		= blcY + y;
+	static const SLIM_EFFORT plans[SLIM_EFFORT_MAX + 1] = {
+		{ SLIM_CODEC_RLE,											false,	SLIM_ORDER_FIRST },		//0
+		{ SLIM_CODEC_RLE,											true,	SLIM_ORDER_SORTED },	//1
+		{ SLIM_CODEC_RLE | SLIM_CODEC_MASKARED,						true,	SLIM_ORDER_SORTED },	//2
+		{ SLIM_CODEC_RLE | SLIM_CODEC_RICE | SLIM_CODEC_MASKARED,	true,	SLIM_ORDER_SORTED },	//3
+		{ SLIM_CODEC_ALL,											true,	SLIM_ORDER_SORTED },	//4
+		{ SLIM_CODEC_ALL,											true,	SLIM_ORDER_FREQUENT },	//5
+		{ SLIM_CODEC_ALL,											true,	SLIM_ORDER_SORTED | SLIM_ORDER_FREQUENT },	//6
+		{ SLIM_CODEC_ALL | SLIM_CODEC_RICE_EXACT,					true,	SLIM_ORDER_SORTED | SLIM_ORDER_FREQUENT | SLIM_ORDER_FIRST },	//7
+	};
+
+	return plans[std::min<uint8_t>(effort, SLIM_EFFORT_MAX)];
+}
 
-					if (column >= m_WIDTH || row >= m_HEIGHT) {continue; }
 
-					uint32_t index = 3 * (row * m_WIDTH + column);
+uint16_t SIZE_REVOLVER(const uint8_t* src, uint32_t size, uint32_t &r_size, uint8_t codecs = SLIM_CODEC_ALL) {
 
-					uint8_t Rc = img[index];
-					uint8_t Gc = img[index+1];
-					uint8_t Bc = img[index+2];
+	//--------------------------------------------------------------//
+	//Pick the revolver codec from the exact packed sizes
+	//--------------------------------------------------------------//
 
-					if(qnt>0){
-						Rc /= qnt;
-						Gc /= qnt;
-						Bc /= qnt;
-					}
+	uint32_t r_size_pack    [5]{size,size,size,size,size};
 
-					GEN_CLR_MAP_RGB(l_ch0, l_ch1, l_ch2, CColor, l_idx, Cout, Rc, Gc, Bc);
-					++Cout;
-				}
-			}
+	if (codecs & SLIM_CODEC_RLE)		{ RLE_SIZE_CALC(src, size, r_size_pack[1]); }
+	if (codecs & SLIM_CODEC_RICE)		{ RICE_SIZE_CALC(src, size, r_size_pack[2], (codecs & SLIM_CODEC_RICE_EXACT) ? RICE_K_EXACT : RICE_K_MEAN); }
+	if (codecs & SLIM_CODEC_SLDD)		{ SLDD_SIZE_CALC(src, size, r_size_pack[3]); }
+	if (codecs & SLIM_CODEC_MASKARED)	{ MASKARED_SIZE_CALC(src, size, r_size_pack[4]); }
 
-			const bool ch0_org	= IsOrgLine(m_ch0, l_ch0, CColor);
-			const bool ch1_org	= IsOrgLine(m_ch1, l_ch1, CColor);
-			const bool ch2_org	= IsOrgLine(m_ch2, l_ch2, CColor);
-			const bool idx_org	= IsOrgLine(m_idx, l_idx, Cout);
+	uint16_t pos_mode = 0;
 
-			if(ch0_org||ch1_org||ch2_org){
-				for (uint32_t i = 0; i < CColor; ++i) {
-					if(ch0_org){m_ch0[i] = l_ch0[i];}
-					if(ch1_org){m_ch1[i] = l_ch1[i];}
-					if(ch2_org){m_ch2[i] = l_ch2[i];}
-				}
-				for (uint32_t i = CColor; i < 256; ++i) {
-					m_ch0[i]=0;
-					m_ch1[i]=0;
-					m_ch2[i]=0;
-				}
-			}
+    for(uint16_t i = 1; i < 5; ++i){
+        if(r_size_pack[pos_mode]>r_size_pack[i]){
+            pos_mode = i;
+        }
+    }
 
-			if(idx_org){
-				for (uint32_t i = 0; i < Cout; ++i) {
-					m_idx[i] = l_idx[i];
-				}
-				for (uint32_t i = Cout; i < 256; ++i) {
-					m_idx[i] = 0;
-				}
-			}
+	r_size = r_size_pack[pos_mode];
 
-			uint32_t ch0_c = 0;
-			uint32_t ch1_c = 0;
-			uint32_t ch2_c = 0;
-			uint32_t idx_c = 0;
+	return pos_mode;
+}
 
-			const uint16_t v0 = ENCODE_REVOLVER(ch0_org, l_ch0, m_write, CColor, ch0_c);
-			const uint16_t v1 = ENCODE_REVOLVER(ch1_org, l_ch1, m_write + ch0_c, CColor, ch1_c);
-			const uint16_t v2 = ENCODE_REVOLVER(ch2_org, l_ch2, m_write + ch0_c + ch1_c, CColor, ch2_c);
-			const uint16_t v4 = ENCODE_REVOLVER(idx_org, l_idx, m_write + ch0_c + ch1_c + ch2_c, Cout, idx_c);
-			
-			uint16_t meta_code = v0 * 1296u + v1 * 216u + v2 * 36u + v4;
 
-    		meta_code = uint16_t((meta_code << 0x03u) | (qnt_idx & 0x07u));
+uint32_t SLIM_BLOCK_COST(const SLIM_EFFORT &plan, const uint8_t* l_data, uint32_t channels, uint32_t CColor, uint32_t Cout){
 
-			outfile.write(&meta_code, 1, 2);
+	//Packed bytes of all streams without reuse
 
-			uint8_t cm_size = 0;
+	uint32_t total = 0;
 
-			if(ch0_org){ m_size[cm_size++]=uint8_t(ch0_c - 0x1u);}
-			if(ch1_org){ m_size[cm_size++]=uint8_t(ch1_c - 0x1u);}
-			if(ch2_org){ m_size[cm_size++]=uint8_t(ch2_c - 0x1u);}
-			if(idx_org){ m_size[cm_size++]=uint8_t(idx_c - 0x1u);}
+	for (uint32_t s = 0; s <= channels; ++s)
+	{
+		uint32_t r_size = 0;
 
-			outfile.write(m_size, 1, cm_size);
-			outfile.write(m_write, 1, ch0_c + ch1_c + ch2_c + idx_c);
-		}
+		SIZE_REVOLVER(l_data + 256u * s, (s == channels) ? Cout : CColor, r_size, plan.codecs);
+		total += r_size;
 	}
 
-	return SLIMERROR::ERROR_OK;
+	return total;
 }
 
 
-SLIMERROR SLIM_WRITE_BLOCKS_4CHANNEL(MiniStream &outfile, SLIM_INFO &header, uint8_t* &img){
+void SLIM_BLOCK_PALETTE(const SLIM_EFFORT &plan, const uint32_t* uniq, uint32_t colors, const uint8_t* ids, uint32_t count, uint32_t channels, uint8_t* l_data){
 
-	uint32_t m_WIDTH = (uint32_t)header._WIDTH;
-	uint32_t m_HEIGHT = (uint32_t)header._HEIGHT;
+	//--------------------------------------------------------------//
+	//Build the palette in every order of the plan and keep the one
+	//that packs smallest, a single order is built without packing
+	//--------------------------------------------------------------//
 
-	uint8_t m_data		[1280]{0}; 	//Old		block memory
-	uint8_t l_data		[1280]{0}; 	//Curret	block memory
-	uint8_t m_write		[1280]{0}; 	//Curret	block packed
-	uint8_t m_size		[5]{0};		//Size 		blocks packed
+	static const uint8_t orders[3] = { SLIM_ORDER_SORTED, SLIM_ORDER_FREQUENT, SLIM_ORDER_FIRST };
 
-	//Pointers old block memory
-	uint8_t* m_ch0 = m_data;
-	uint8_t* m_ch1 = m_data + 256u;
-	uint8_t* m_ch2 = m_data + 512u;
-	uint8_t* m_ch3 = m_data + 768u;
-	uint8_t* m_idx = m_data + 1024u;
+	const bool search = (plan.orders & (plan.orders - 1u)) != 0;
 
-	//Pointers curret block memory
-	uint8_t* l_ch0 = l_data;
-	uint8_t* l_ch1 = l_data + 256u;
-	uint8_t* l_ch2 = l_data + 512u;
-	uint8_t* l_ch3 = l_data + 768u;
-	uint8_t* l_idx = l_data + 1024u;
+	uint8_t t_data[1280];	//Candidate block memory
+	uint32_t best = 0xFFFFFFFFu;
 
-	for (uint32_t blcY = 0; blcY < m_HEIGHT; blcY += 16)
+	for (uint32_t i = 0; i < 3; ++i)
 	{
-		for (uint32_t blcX = 0; blcX < m_WIDTH; blcX += 16)
-		{
-			uint32_t Cout = 0;
-			uint32_t CColor = 0;
-			uint32_t qnt_idx = BLOCK_ANALYZER(header._LEVEL, img, m_WIDTH, m_HEIGHT, blcX, blcY, 4);
-			uint32_t qnt	= qnt_idx << 1;
-
-			for (uint32_t y = 0; y < 16; ++y)
-			{
-				for (uint32_t x = 0; x < 16; ++x)
-				{
-					uint32_t column = blcX + x;
-					uint32_t row = blcY + y;
+		if (!(plan.orders & orders[i])) { continue; }
 
-					if (column>=m_WIDTH || row>= m_HEIGHT) { continue; }
+		uint8_t* dst = (best == 0xFFFFFFFFu) ? l_data : t_data;
 
-					uint32_t index = 4 * (row * m_WIDTH + column);
-
-					uint8_t Rc = img[index];
-					uint8_t Gc = img[index + 1];
-					uint8_t Bc = img[index + 2];
-					uint8_t Ac = img[index + 3];
+		switch (orders[i])
+		{
+			case SLIM_ORDER_SORTED:		SLIM_PALETTE_SORT(uniq, colors, ids, count, channels, dst);		break;
+			case SLIM_ORDER_FREQUENT:	SLIM_PALETTE_FREQUENT(uniq, colors, ids, count, channels, dst);	break;
+			default:					SLIM_PALETTE_STORE(uniq, colors, ids, count, channels, dst);		break;
+		}
 
-					if(Ac<1){Rc=0;Gc=0;Bc=0;}
+		if (!search) { return; }
 
-					if(qnt>0){
-						Rc /= qnt;
-						Gc /= qnt;
-						Bc /= qnt;
-						Ac /= qnt;
-					}
+		const uint32_t cost = SLIM_BLOCK_COST(plan, dst, channels, colors, count);
 
-					GEN_CLR_MAP_RGBA(l_ch0, l_ch1, l_ch2, l_ch3, CColor, l_idx, Cout, Rc, Gc, Bc, Ac);
-					++Cout;
-				}
-			}
+		if (cost < best) {
+			if (dst != l_data) {
+				for (uint32_t s = 0; s < channels; ++s) { memcpy(l_data + 256u * s, t_data + 256u * s, colors); }
 
-			const bool ch0_org	= IsOrgLine(m_ch0, l_ch0, CColor);
-			const bool ch1_org	= IsOrgLine(m_ch1, l_ch1, CColor);
-			const bool ch2_org	= IsOrgLine(m_ch2, l_ch2, CColor);
-			const bool ch3_org	= IsOrgLine(m_ch3, l_ch3, CColor);
-			const bool idx_org	= IsOrgLine(m_idx, l_idx, Cout);
-
-			if (ch0_org || ch1_org || ch2_org|| ch3_org) {
-				for (uint32_t i = 0; i < CColor; ++i) {
-					if (ch0_org) { m_ch0[i] = l_ch0[i]; }
-					if (ch1_org) { m_ch1[i] = l_ch1[i]; }
-					if (ch2_org) { m_ch2[i] = l_ch2[i]; }
-					if (ch3_org) { m_ch3[i] = l_ch3[i]; }
-				}
-				for (uint32_t i = CColor; i < 256; ++i) {
-					m_ch0[i] = 0;
-					m_ch1[i] = 0;
-					m_ch2[i] = 0;
-					m_ch3[i] = 0;
-				}
+				memcpy(l_data + 256u * channels, t_data + 256u * channels, count);
 			}
 
-			if (idx_org) {
-				for (uint32_t i = 0; i < Cout; ++i) {
-					m_idx[i] = l_idx[i];
-				}
-				for (uint32_t i = Cout; i < 256; ++i) {
-					m_idx[i] = 0;
-				}
-			}
+			best = cost;
+		}
+	}
+}
 
-			uint32_t ch0_c = 0;
-			uint32_t ch1_c = 0;
-			uint32_t ch2_c = 0;
-			uint32_t ch3_c = 0;
-			uint32_t idx_c = 0;
 
-			const uint16_t v0 = ENCODE_REVOLVER(ch0_org, l_ch0, m_write, CColor, ch0_c);
-			const uint16_t v1 = ENCODE_REVOLVER(ch1_org, l_ch1, m_write + ch0_c, CColor, ch1_c);
-			const uint16_t v2 = ENCODE_REVOLVER(ch2_org, l_ch2, m_write + ch0_c + ch1_c, CColor, ch2_c);
-			const uint16_t v3 = ENCODE_REVOLVER(ch3_org, l_ch3, m_write + ch0_c + ch1_c + ch2_c, CColor, ch3_c);
-			const uint16_t v4 = ENCODE_REVOLVER(idx_org, l_idx, m_write + ch0_c + ch1_c + ch2_c + ch3_c, Cout, idx_c);
+uint16_t ENCODE_REVOLVER(bool orig, uint8_t* src, uint8_t* dest, uint32_t size, uint32_t &r_size, uint8_t codecs = SLIM_CODEC_ALL) {
 
-			uint16_t meta_code = v0 * 1296u + v1 * 216u + v2 * 36u + v3 * 6u + v4;
+	//--------------------------------------------------------------//
+	//Encode by the revolver method
+	//--------------------------------------------------------------//
 
-			meta_code = uint16_t((meta_code << 0x03u) | (qnt_idx & 0x07u));
+	if (size <= 0) { return 0; }
+	if (orig==false)  {return 0; }
 
-			outfile.write(&meta_code, 1, 2);
+	const uint16_t pos_mode = SIZE_REVOLVER(src, size, r_size, codecs);
 
-			uint8_t cm_size = 0;
+	if (pos_mode == 0) {
+		memcpy(dest, src, r_size);
+		return 1;
+	}
 
-			if(ch0_org){ m_size[cm_size++]=uint8_t(ch0_c - 0x1u);}
-			if(ch1_org){ m_size[cm_size++]=uint8_t(ch1_c - 0x1u);}
-			if(ch2_org){ m_size[cm_size++]=uint8_t(ch2_c - 0x1u);}
-			if(ch3_org){ m_size[cm_size++]=uint8_t(ch3_c - 0x1u);}
-			if(idx_org){ m_size[cm_size++]=uint8_t(idx_c - 0x1u);}
+	//The bit packers write up to size + 1 bytes before the tails
+	//remover, so only the winner is packed here
+	uint8_t t_pack[260];
+	uint8_t* pack = t_pack;
+	uint32_t p_size = 0;
 
-			outfile.write(m_size, 1, cm_size);
-			outfile.write(m_write, 1, ch0_c + ch1_c + ch2_c + ch3_c + idx_c);
+	switch (pos_mode)
+	{
+		case 1: RLE_ENCODE(src, size, pack, p_size); break;
+		case 2: RICE_ENCODE(src, size, pack, p_size, (codecs & SLIM_CODEC_RICE_EXACT) ? RICE_K_EXACT : RICE_K_MEAN); break;
+		case 3: SLDD_ENCODE(src, size, pack, p_size); break;
+		default: MASKARED_ENCODE(src, size, pack, p_size); break;
+	}
+
+	memcpy(dest, t_pack, r_size);
+
+	return pos_mode+1;
+}
+
+
+
+
+void  DECODE_REVOLVER(uint16_t mode, const uint8_t* src, uint8_t* dest, uint32_t size) {
+
+	//--------------------------------------------------------------//
+	//Decode by the revolver method
+	//--------------------------------------------------------------//
+
+	if (size<=0) { return; }
+	if (mode==0)  { return; }
+
+	uint32_t r_size = 0;
+
+	switch (mode)
+	{
+		case 1:
+		{
+			uint8_t* d = dest;
+			const uint8_t* s = src;
+			const uint8_t* e = s + size;
+			while (s < e) {*d++ = *s++;}
+			break;
+		}	
+		case 2:
+		{
+			RLE_DECODE_SAFE(src, size, dest, r_size, 256);
+			break;
+		}
+		case 3:
+		{
+			r_size = 256;
+			RICE_DECODE(src, size, dest, r_size);
+			break;
+		}
+		case 4:
+		{
+			r_size = 256;
+			SLDD_DECODE(src, size, dest, r_size);
+			break;
+		}		
+		case 5:
+		{
+			r_size = 256;
+			MASKARED_DECODE(src, size, dest, r_size);
+			break;
+		}
+		default:
+		{
+			return;
+		}		
+	}
+}
+
+
+const double* SLIM_ERROR_TABLE(uint32_t levelq){
+
+	//--------------------------------------------------------------//
+	//Squared quantization error of every channel value for the
+	//palette levels a block can reach (256 colors -> level 7)
+	//--------------------------------------------------------------//
+
+	struct SLIM_ERRORS {
+		double d2[8][256];
+
+		SLIM_ERRORS() {
+			for (uint32_t l = 0; l < 8; ++l)
+			{
+				const double invLevelq = l == 0 ? 1.0 : 1.0 / l * 2.0;
+
+				for (uint32_t v = 0; v < 256; ++v)
+				{
+					double c = (double)v;
+					double d = c - (c * invLevelq);
+					d2[l][v] = d * d;
+				}
+			}
+		}
+	};
+
+	static const SLIM_ERRORS table;
+
+	return table.d2[levelq];
+}
+
+
+uint32_t BLOCK_ANALYZER(uint8_t level, const uint8_t* px, uint32_t pixels, uint32_t channels, uint32_t colorCount, uint64_t squares) {
+
+	//--------------------------------------------------------------//
+	//px - block pixels packed without stride, colorCount - unique
+	//colors, squares - sum of the squared channel values
+	//--------------------------------------------------------------//
+
+   	uint32_t levelq = colorCount * 0.0274509803;  // (7 / 255)
+
+	if (levelq == 0) { return 0; }
+
+	const uint32_t count = pixels * channels;
+
+	//--------------------------------------------------------------//
+	//PSNR Analysis: with levelq 1, 2 and 4 every error term is exact
+	//so the sum does not depend on the order, otherwise the terms
+	//are added in pixel order as the reference estimate does
+	//--------------------------------------------------------------//
+
+	double sumDiff = 0;
+
+	switch (levelq)
+	{
+	case 1:	sumDiff = (double)squares;			break;	//d = -c
+	case 2:	sumDiff = 0;						break;	//d = 0
+	case 4:	sumDiff = (double)squares * 0.25;	break;	//d = c / 2
+	default:
+		{
+			const double* d2 = SLIM_ERROR_TABLE(levelq);
+
+			for (uint32_t i = 0; i < count; ++i) { sumDiff += d2[px[i]]; }
+		}
+	}
+
+	double psnr = 1.0 - (sumDiff / count / 65025.0);
+
+	//--------------------------------------------------------------//
+	//Adjusting the evaluation level and quantization
+	//--------------------------------------------------------------//
+
+	if (psnr < 0.0){psnr = 0.0;}
+    if (psnr > 1.0){psnr = 1.0;}
+    
+  	const double factor = (255.0 - (double)level) * 0.0156862745; //(4.0 / 255.0)
+
+	uint32_t idxt = levelq * psnr * factor;
+
+	if (idxt > 7){ idxt = 7;}
+
+	return idxt;
+}
+
+
+
+uint32_t SLIM_MIP_SIZE(uint32_t size, uint32_t level){
+
+	return std::max(1u, size >> level);
+}
+
+
+uint32_t SLIM_MIP_LEVELS(uint32_t w, uint32_t h){
+
+	//--------------------------------------------------------------//
+	//Levels below the base image until both sides reach one pixel
+	//--------------------------------------------------------------//
+
+	uint32_t levels = 0;
+
+	while ((w >> levels) > 1u || (h >> levels) > 1u) { ++levels; }
+
+	return levels;
+}
+
+
+void SLIM_MIP_DOWNSAMPLE(const uint8_t* src, uint32_t sw, uint32_t sh, uint32_t channels, uint8_t* dst){
+
+	//--------------------------------------------------------------//
+	//2x2 box filter, colors weighted by alpha so that transparent
+	//pixels do not bleed into the edges
+	//--------------------------------------------------------------//
+
+	const uint32_t dw = SLIM_MIP_SIZE(sw, 1);
+	const uint32_t dh = SLIM_MIP_SIZE(sh, 1);
+
+	for (uint32_t y = 0; y < dh; ++y)
+	{
+		const uint32_t y0 = std::min(y * 2u, sh - 1u);
+		const uint32_t y1 = std::min(y * 2u + 1u, sh - 1u);
+
+		for (uint32_t x = 0; x < dw; ++x)
+		{
+			const uint32_t x0 = std::min(x * 2u, sw - 1u);
+			const uint32_t x1 = std::min(x * 2u + 1u, sw - 1u);
+
+			const uint8_t* px[4] = {
+				src + ((size_t)y0 * sw + x0) * channels,
+				src + ((size_t)y0 * sw + x1) * channels,
+				src + ((size_t)y1 * sw + x0) * channels,
+				src + ((size_t)y1 * sw + x1) * channels
+			};
+
+			uint8_t* out = dst + ((size_t)y * dw + x) * channels;
+
+			uint32_t alpha = 0;
+
+			if (channels == 4) {
+				alpha = px[0][3] + px[1][3] + px[2][3] + px[3][3];
+				out[3] = (uint8_t)((alpha + 2u) >> 2);
+			}
+
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				if (alpha > 0) {
+					const uint32_t sum = px[0][c] * px[0][3] + px[1][c] * px[1][3] + px[2][c] * px[2][3] + px[3][c] * px[3][3];
+					out[c] = (uint8_t)((sum + alpha / 2u) / alpha);
+				}
+				else {
+					out[c] = (uint8_t)((px[0][c] + px[1][c] + px[2][c] + px[3][c] + 2u) >> 2);
+				}
+			}
+		}
+	}
+}
+
+
+void SLIM_BUILD_BLOCK(uint8_t level, const SLIM_EFFORT &plan, const uint8_t* src, size_t stride, uint32_t bw, uint32_t bh, uint32_t channels, uint8_t* l_data, uint32_t &CColor, uint32_t &Cout, uint32_t &qnt_idx){
+
+	//--------------------------------------------------------------//
+	//Quantize the block and build its sorted palette, src points to
+	//the top left pixel and bw x bh is the part inside the image.
+	//The pixels are read once into a packed copy that also gives the
+	//unique colors and squared sums for the analyzer.
+	//--------------------------------------------------------------//
+
+	uint8_t  px		[1024];	//Block pixels without stride
+	uint32_t keys	[256];	//Packed colors in pixel order
+	uint32_t uniq	[256];	//Unique colors
+	uint8_t  ids	[256];	//Pixel -> unique color
+
+	uint64_t squares	= 0;
+	bool	 cleared	= false;	//Transparent pixels with color
+
+	Cout = 0;
+
+	for (uint32_t y = 0; y < bh; ++y)
+	{
+		const uint8_t* row = src + (size_t)y * stride;
+
+		for (uint32_t x = 0; x < bw; ++x, ++Cout)
+		{
+			const uint8_t* in	= row + (size_t)x * channels;
+			uint8_t* out		= px + Cout * channels;
+
+			const uint32_t r = in[0];
+			const uint32_t g = in[1];
+			const uint32_t b = in[2];
+			const uint32_t a = (channels == 4) ? in[3] : 0u;
+
+			out[0] = (uint8_t)r;
+			out[1] = (uint8_t)g;
+			out[2] = (uint8_t)b;
+
+			if (channels == 4) {
+				out[3] = (uint8_t)a;
+				cleared |= (a == 0 && (r | g | b) != 0);
+			}
+
+			squares		+= r * r + g * g + b * b + a * a;
+			keys[Cout]	= (r << 24) | (g << 16) | (b << 8) | a;
+		}
+	}
+
+	const uint32_t colors = SLIM_PALETTE_DEDUP(keys, Cout, uniq, ids);
+
+	qnt_idx	= BLOCK_ANALYZER(level, px, Cout, channels, colors, squares);
+
+	const uint32_t qnt = qnt_idx << 1;
+
+	//Without quantization the unique colors already are the palette
+	if (qnt == 0 && !cleared) {
+		if (channels == 3) {
+			for (uint32_t i = 0; i < colors; ++i) { uniq[i] >>= 8; }
+		}
+
+		CColor = colors;
+
+		SLIM_BLOCK_PALETTE(plan, uniq, CColor, ids, Cout, channels, l_data);
+		return;
+	}
+
+	for (uint32_t p = 0; p < Cout; ++p)
+	{
+		const uint8_t* in = px + p * channels;
+
+		uint8_t Rc = in[0];
+		uint8_t Gc = in[1];
+		uint8_t Bc = in[2];
+
+		if (channels == 4) {
+			uint8_t Ac = in[3];
+
+			if(Ac<1){Rc=0;Gc=0;Bc=0;}
+
+			if(qnt>0){
+				Rc /= qnt;
+				Gc /= qnt;
+				Bc /= qnt;
+				Ac /= qnt;
+			}
+
+			keys[p] = ((uint32_t)Rc << 24) | ((uint32_t)Gc << 16) | ((uint32_t)Bc << 8) | (uint32_t)Ac;
+		}
+		else {
+			if(qnt>0){
+				Rc /= qnt;
+				Gc /= qnt;
+				Bc /= qnt;
+			}
+
+			keys[p] = ((uint32_t)Rc << 16) | ((uint32_t)Gc << 8) | (uint32_t)Bc;
+		}
+	}
+
+	CColor = SLIM_PALETTE_DEDUP(keys, Cout, uniq, ids);
+
+	SLIM_BLOCK_PALETTE(plan, uniq, CColor, ids, Cout, channels, l_data);
+}
+
+
+//Decoder stream memory as the encoder tracks it
+struct		SLIM_REUSE_STATE {
+
+	uint8_t					data	[1280];	//Streams held by the decoder
+	uint16_t				known	[5];	//Leading bytes of every stream that are known
+};
+
+
+void SLIM_REUSE_RESET(SLIM_REUSE_STATE &state){
+
+	//The decoder starts and restarts with every stream zeroed
+	memset(state.data, 0, sizeof(state.data));
+
+	for (uint32_t s = 0; s < 5; ++s) { state.known[s] = 256u; }
+}
+
+
+void SLIM_REUSE_BLOCK(const SLIM_EFFORT &plan, SLIM_REUSE_STATE &state, uint8_t* l_data, uint32_t channels, uint32_t CColor, uint32_t Cout, bool* org){
+
+	//--------------------------------------------------------------//
+	//Compare with the decoder state and update it (org[4] - index).
+	//Past the decoded length the decoders leave codec dependent
+	//bytes, so a stream is reused only inside its known bytes.
+	//--------------------------------------------------------------//
+
+	for (uint32_t s = 0; s < 5; ++s)
+	{
+		const bool idx	= (s == 4);
+
+		if (!idx && s >= channels) { org[s] = false; continue; }
+
+		const uint32_t count	= idx ? Cout : CColor;
+		const uint32_t line		= 256u * (idx ? channels : s);
+
+		//Without reuse every stream is stored and the state is never read
+		if (!plan.reuse) { org[s] = true; continue; }
+
+		org[s] = (count > state.known[s]) || IsOrgLine(state.data + line, l_data + line, count);
+
+		if (org[s]) {
+			memcpy(state.data + line, l_data + line, count);
+			state.known[s] = (uint16_t)count;
+		}
+	}
+}
+
+
+uint32_t SLIM_PACK_BLOCK(const SLIM_EFFORT &plan, uint8_t* l_data, uint32_t channels, uint32_t CColor, uint32_t Cout, uint32_t qnt_idx, const bool* org, uint8_t* m_write, uint16_t* v, uint32_t* sizes){
+
+	//--------------------------------------------------------------//
+	//Pack the block: meta code, stream sizes and stream payloads
+	//--------------------------------------------------------------//
+
+	uint8_t cm_size = 0;
+
+	for (uint32_t s = 0; s < 5; ++s) { cm_size += org[s]; }
+
+	uint8_t* m_size	= m_write + 2u;
+	uint8_t* m_pack	= m_size + cm_size;
+	uint32_t total	= 0;
+
+	cm_size = 0;
+
+	for (uint32_t s = 0; s < 5; ++s)
+	{
+		const bool idx	= (s == 4);
+
+		v[s]		= 0;
+		sizes[s]	= 0;
+
+		if (!idx && s >= channels) { continue; }
+
+		uint32_t r_size = 0;
+		uint8_t* src	= l_data + 256u * (idx ? channels : s);
+
+		v[s] = ENCODE_REVOLVER(org[s], src, m_pack + total, idx ? Cout : CColor, r_size, plan.codecs);
+
+		if (org[s]) { m_size[cm_size++] = uint8_t(r_size - 0x1u); }
+		sizes[s] = r_size;
+
+		total += r_size;
+	}
+
+	uint16_t meta_code = v[0] * 1296u + v[1] * 216u + v[2] * 36u + v[3] * 6u + v[4];
+
+	meta_code = uint16_t((meta_code << 0x03u) | (qnt_idx & 0x07u));
+
+	memcpy(m_write, &meta_code, 2);
+
+	return 2u + cm_size + total;
+}
+
+
+int64_t SLIM_RESTART_DELTA(const SLIM_EFFORT &plan, uint8_t* l_data, uint32_t channels, uint32_t CColor, uint32_t Cout, const bool* org, const bool* c_org, const uint32_t* sizes){
+
+	//--------------------------------------------------------------//
+	//Bytes the block costs over the unbroken reuse chain (c_org)
+	//--------------------------------------------------------------//
+
+	int64_t delta = 0;
+
+	for (uint32_t s = 0; s < 5; ++s)
+	{
+		if (org[s] == c_org[s]) { continue; }
+
+		if (org[s]) {
+			delta += 1 + (int64_t)sizes[s];
+		}
+		else {
+			uint32_t r_size = 0;
+			const bool idx	= (s == 4);
+
+			SIZE_REVOLVER(l_data + 256u * (idx ? channels : s), idx ? Cout : CColor, r_size, plan.codecs);
+			delta -= 1 + (int64_t)r_size;
+		}
+	}
+
+	return delta;
+}
+
+
+//Encoder state carried from one block row to the next
+struct		SLIM_WRITE_STATE {
+
+	SLIM_REUSE_STATE		m_data;			//Old block memory
+	SLIM_REUSE_STATE		c_data;			//Old block memory without restarts
+	uint64_t				written;		//Bytes of block data written
+	uint32_t				block;			//Block number
+};
+
+
+template<class StreamT>
+SLIMERROR SLIM_WRITE_STRIP(StreamT &outfile, SLIM_INFO &header, const uint8_t* rows, size_t stride, uint32_t bh, uint32_t channels, SLIM_INDEX* index, SLIM_INFO_FULL* info, SLIM_WRITE_STATE &state){
+
+	//--------------------------------------------------------------//
+	//Encodes one row of blocks, rows points to the first of its bh
+	//image rows (16, fewer only at the bottom of the image)
+	//--------------------------------------------------------------//
+
+	const uint32_t m_WIDTH	= (uint32_t)header._WIDTH;
+	const uint32_t restart	= (header._FLAGS & FLAG_RESTART) ? header._RESTART : 0u;
+	const bool cost			= (restart > 0 && info != NULL);
+	const SLIM_EFFORT plan	= SLIM_EFFORT_PLAN(header._EFFORT);
+
+	uint8_t l_data		[1280]{0}; 	//Curret	block memory
+	uint8_t m_write		[1296]{0}; 	//Curret	block packed
+
+	for (uint32_t blcX = 0; blcX < m_WIDTH; blcX += 16, ++state.block)
+	{
+		const uint32_t block = state.block;
+
+		if (index != NULL && block % index->_SEGMENT == 0) { index->_OFFSET[block / index->_SEGMENT] = state.written; }
+
+		//Every interval starts with a clean decoder state
+		if (restart > 0 && block % restart == 0) { SLIM_REUSE_RESET(state.m_data); }
+
+		uint32_t Cout		= 0;
+		uint32_t CColor		= 0;
+		uint32_t qnt_idx	= 0;
+
+		SLIM_BUILD_BLOCK(header._LEVEL, plan, rows + (size_t)blcX * channels, stride, std::min(16u, m_WIDTH - blcX), bh, channels, l_data, CColor, Cout, qnt_idx);
+
+		bool org[5];
+		uint16_t comp_pack[5];
+		uint32_t sizes[5];
+
+		SLIM_REUSE_BLOCK(plan, state.m_data, l_data, channels, CColor, Cout, org);
+
+		const uint32_t m_bytes = SLIM_PACK_BLOCK(plan, l_data, channels, CColor, Cout, qnt_idx, org, m_write, comp_pack, sizes);
+
+		if (!outfile.write(m_write, 1, m_bytes)) { return SLIMERROR::ERROR_BLOCK; }
+
+		state.written += m_bytes;
+
+		if (info != NULL) { SLIM_INFO_ADD_BLOCK(*info, comp_pack, qnt_idx << 1, CColor); }
+
+		//--------------------------------------------------------------//
+		//Size cost of the restarts: replay the unbroken reuse chain
+		//--------------------------------------------------------------//
+
+		if (cost) {
+			bool c_org[5];
+
+			SLIM_REUSE_BLOCK(plan, state.c_data, l_data, channels, CColor, Cout, c_org);
+
+			info->_RESTART_COST += SLIM_RESTART_DELTA(plan, l_data, channels, CColor, Cout, org, c_org, sizes);
+		}
+	}
+
+	return SLIMERROR::ERROR_OK;
+}
+
+
+template<class StreamT>
+SLIMERROR SLIM_WRITE_BLOCKS(StreamT &outfile, SLIM_INFO &header, uint8_t* &img, uint32_t channels, SLIM_INDEX* index, SLIM_INFO_FULL* info){
+
+	const uint32_t m_WIDTH	= (uint32_t)header._WIDTH;
+	const uint32_t m_HEIGHT	= (uint32_t)header._HEIGHT;
+	const size_t stride		= (size_t)m_WIDTH * channels;
+
+	SLIM_WRITE_STATE state{};
+
+	SLIM_REUSE_RESET(state.m_data);
+	SLIM_REUSE_RESET(state.c_data);
+
+	for (uint32_t blcY = 0; blcY < m_HEIGHT; blcY += 16)
+	{
+		SLIMERROR res = SLIM_WRITE_STRIP(outfile, header, img + (size_t)blcY * stride, stride, std::min(16u, m_HEIGHT - blcY), channels, index, info, state);
+
+		if (res != SLIMERROR::ERROR_OK) { return res; }
+	}
+
+	return SLIMERROR::ERROR_OK;
+}
+
+
+
+
+template<class StreamT>
+SLIMERROR SLIM_WRITE_BLOCKS_PARALLEL(StreamT &outfile, SLIM_INFO &header, uint8_t* &img, uint32_t channels, SLIM_INDEX* index, SLIM_INFO_FULL* info, MiniPool &pool){
+
+	//--------------------------------------------------------------//
+	//Blocks are encoded in bands: palettes are built and packed on
+	//the pool, only the reuse chain and the write run in block order,
+	//so the output is identical to SLIM_WRITE_BLOCKS for any pool
+	//--------------------------------------------------------------//
+
+	struct SLIM_BLOCK_STATE {
+		uint8_t		l_data	[1280];
+		uint8_t		m_write	[SLIM_BLOCK_MAX];
+		uint32_t	CColor, Cout, qnt_idx, bytes;
+		bool		org[5], c_org[5];
+		uint16_t	comp_pack[5];
+		int64_t		cost;
+	};
+
+	const uint32_t m_WIDTH	= (uint32_t)header._WIDTH;
+	const uint32_t m_HEIGHT	= (uint32_t)header._HEIGHT;
+	const uint32_t blocksX	= (m_WIDTH + 15u) >> 4;
+	const uint32_t blocks	= blocksX * ((m_HEIGHT + 15u) >> 4);
+	const uint32_t restart	= (header._FLAGS & FLAG_RESTART) ? header._RESTART : 0u;
+	const bool cost			= (restart > 0 && info != NULL);
+	const SLIM_EFFORT plan	= SLIM_EFFORT_PLAN(header._EFFORT);
+	const uint32_t band		= std::min(blocks, pool.size() * 256u);
+
+	std::vector<SLIM_BLOCK_STATE> state;
+
+	try { state.resize(band); } catch (const std::bad_alloc&) { return SLIMERROR::ERROR_MEM; }
+
+	SLIM_REUSE_STATE m_data;	//Old		block memory
+	SLIM_REUSE_STATE c_data;	//Old		block memory without restarts
+
+	SLIM_REUSE_RESET(m_data);
+	SLIM_REUSE_RESET(c_data);
+
+	uint64_t written	= 0;	//Bytes of block data written
+
+	for (uint32_t first = 0; first < blocks; first += band)
+	{
+		const uint32_t count = std::min(band, blocks - first);
+
+		//Palettes do not depend on other blocks
+		pool.run(count, [&](uint32_t task, uint32_t) {
+			SLIM_BLOCK_STATE &b	= state[task];
+			const uint32_t block	= first + task;
+
+			const uint32_t blcX		= (block % blocksX) << 4;
+			const uint32_t blcY		= (block / blocksX) << 4;
+
+			const uint8_t* src		= img + ((size_t)blcY * m_WIDTH + blcX) * channels;
+
+			SLIM_BUILD_BLOCK(header._LEVEL, plan, src, (size_t)m_WIDTH * channels, std::min(16u, m_WIDTH - blcX), std::min(16u, m_HEIGHT - blcY), channels, b.l_data, b.CColor, b.Cout, b.qnt_idx);
+		});
+
+		//The reuse chain is sequential but only compares and copies
+		for (uint32_t task = 0; task < count; ++task)
+		{
+			SLIM_BLOCK_STATE &b = state[task];
+
+			if (restart > 0 && (first + task) % restart == 0) { SLIM_REUSE_RESET(m_data); }
+
+			SLIM_REUSE_BLOCK(plan, m_data, b.l_data, channels, b.CColor, b.Cout, b.org);
+
+			if (cost) { SLIM_REUSE_BLOCK(plan, c_data, b.l_data, channels, b.CColor, b.Cout, b.c_org); }
+		}
+
+		pool.run(count, [&](uint32_t task, uint32_t) {
+			SLIM_BLOCK_STATE &b = state[task];
+
+			uint32_t sizes[5];
+
+			b.bytes = SLIM_PACK_BLOCK(plan, b.l_data, channels, b.CColor, b.Cout, b.qnt_idx, b.org, b.m_write, b.comp_pack, sizes);
+			b.cost	= cost ? SLIM_RESTART_DELTA(plan, b.l_data, channels, b.CColor, b.Cout, b.org, b.c_org, sizes) : 0;
+		});
+
+		for (uint32_t task = 0; task < count; ++task)
+		{
+			SLIM_BLOCK_STATE &b	= state[task];
+			const uint32_t block	= first + task;
+
+			if (index != NULL && block % index->_SEGMENT == 0) { index->_OFFSET[block / index->_SEGMENT] = written; }
+
+			if (!outfile.write(b.m_write, 1, b.bytes)) { return SLIMERROR::ERROR_BLOCK; }
+
+			written += b.bytes;
+
+			if (info != NULL) {
+				SLIM_INFO_ADD_BLOCK(*info, b.comp_pack, b.qnt_idx << 1, b.CColor);
+				info->_RESTART_COST += b.cost;
+			}
+		}
+	}
+
+	return SLIMERROR::ERROR_OK;
+}
+
+
+
+double perlin_noise_frame[256]{
+0.5, 0.690001, 0.721901, 0.53222, 0.349121, 0.257248, 0.43148, 0.60899, 0.75, 0.60899, 0.445526, 0.473264, 0.573242, 0.46778, 0.278099, 0.309999, 
+0.566247, 0.663996, 0.571459, 0.342413, 0.199621, 0.273598, 0.515754, 0.649168, 0.833123, 0.785823, 0.633541, 0.61574, 0.6523, 0.534027, 0.344346, 0.376246, 
+0.450104, 0.423416, 0.422669, 0.309194, 0.201296, 0.33662, 0.467968, 0.443078, 0.654804, 0.788916, 0.663064, 0.590787, 0.551481, 0.417883, 0.228203, 0.260103, 
+0.469859, 0.403806, 0.51863, 0.49793, 0.39458, 0.495199, 0.524027, 0.403931, 0.501594, 0.598633, 0.476746, 0.481536, 0.549557, 0.437639, 0.247958, 0.279858, 
+0.573242, 0.52097, 0.679409, 0.680848, 0.577637, 0.677615, 0.705353, 0.566797, 0.5, 0.433203, 0.299491, 0.438268, 0.692884, 0.618701, 0.425417, 0.423742, 
+0.473264, 0.455526, 0.718483, 0.772295, 0.66951, 0.769488, 0.797226, 0.649709, 0.5, 0.350291, 0.210568, 0.416959, 0.765737, 0.711214, 0.552636, 0.489614, 
+0.445526, 0.401419, 0.584567, 0.598388, 0.495277, 0.595256, 0.622993, 0.492471, 0.5, 0.507529, 0.379206, 0.457371, 0.627576, 0.538073, 0.482014, 0.529799, 
+0.569366, 0.48351, 0.498379, 0.421648, 0.321869, 0.442154, 0.484472, 0.368035, 0.5, 0.631965, 0.512665, 0.489353, 0.518238, 0.400889, 0.429823, 0.643132, 
+0.5, 0.516876, 0.4547, 0.281735, 0.202637, 0.430729, 0.550461, 0.430634, 0.5, 0.569366, 0.445526, 0.473264, 0.573242, 0.470414, 0.518906, 0.771245, 
+0.430634, 0.601006, 0.615427, 0.423217, 0.33623, 0.527608, 0.620976, 0.493234, 0.5, 0.506766, 0.378388, 0.457175, 0.628247, 0.539313, 0.530374, 0.668105, 
+0.554474, 0.738375, 0.769251, 0.58566, 0.470851, 0.504591, 0.48618, 0.371661, 0.504013, 0.631838, 0.511846, 0.489157, 0.518908, 0.401306, 0.378823, 0.493614, 
+0.526736, 0.570806, 0.578205, 0.53421, 0.481852, 0.36694, 0.274209, 0.280054, 0.596007, 0.803657, 0.680484, 0.529569, 0.380748, 0.226309, 0.141298, 0.225089, 
+0.426758, 0.276093, 0.250797, 0.401208, 0.4768, 0.357735, 0.307171, 0.454365, 0.724121, 0.741051, 0.591561, 0.508259, 0.4536, 0.317116, 0.145025, 0.185646, 
+0.530141, 0.340708, 0.308621, 0.497925, 0.603555, 0.504002, 0.47594, 0.635796, 0.749445, 0.581701, 0.416322, 0.465794, 0.596646, 0.498063, 0.309224, 0.340983, 
+0.549896, 0.430417, 0.375332, 0.518248, 0.644505, 0.597325, 0.529271, 0.604935, 0.681198, 0.553056, 0.393366, 0.402241, 0.551129, 0.53541, 0.450133, 0.464475, 
+0.433753, 0.453874, 0.352895, 0.403238, 0.570657, 0.627995, 0.480133, 0.402954, 0.545002, 0.636284, 0.498129, 0.311498, 0.336932, 0.454374, 0.575767, 0.555351
+};
+
+uint8_t perlin_pixel(uint8_t cut, uint32_t qnt, double noise){
+	uint32_t a = qnt - 1;
+    uint32_t b = 255 - cut * qnt;
+    uint32_t c = (uint32_t)(cut * qnt + ((double)(a < b ? a : b) * noise));
+    return (uint8_t)(c > 255 ? 255 : c);
+}
+
+
+
+void SLIM_META_UNPACK(uint16_t meta_code, uint32_t channels, uint16_t* v, uint32_t &qnt){
+
+	qnt = (meta_code & 0x07u) << 1;
+	meta_code >>= 0x03u;
+
+	uint32_t t;
+
+	t = meta_code / 1296u;  v[0] = t;  meta_code -= t * 1296u;
+	t = meta_code /  216u;  v[1] = t;  meta_code -= t *  216u;
+	t = meta_code /   36u;  v[2] = t;  meta_code -= t *   36u;
+	t = meta_code /    6u;  v[3] = t;  meta_code -= t *    6u;
+	v[4] = meta_code;
+
+	//RGB blocks have no fourth stream
+	if (channels < 4) { v[3] = 0; }
+}
+
+
+uint32_t SLIM_STREAM_SIZES(const uint16_t* v, const uint8_t* m_size, uint32_t* cmps){
+
+	uint32_t cm_pos	= 0;
+	uint32_t total	= 0;
+
+	for (uint32_t s = 0; s < 5; ++s) {
+		cmps[s] = (v[s] > 0) ? 0x1u + (uint32_t)m_size[cm_pos++] : 0x0u;
+		total += cmps[s];
+	}
+
+	return total;
+}
+
+
+void SLIM_DECODE_STREAMS(const uint16_t* v, const uint32_t* cmps, const uint8_t* m_read, uint32_t channels, uint8_t* m_data){
+
+	uint32_t st = 0;
+
+	for (uint32_t s = 0; s < 5; ++s) {
+		DECODE_REVOLVER(v[s], m_read + st, m_data + 256u * (s == 4 ? channels : s), cmps[s]);
+		st += cmps[s];
+	}
+}
+
+
+SLIMERROR SLIM_DECODE_BLOCK(const uint8_t* &p, const uint8_t* end, uint32_t channels, uint8_t* m_data, uint32_t &qnt){
+
+	//--------------------------------------------------------------//
+	//Decode one block from memory into the decoder state
+	//--------------------------------------------------------------//
+
+	uint16_t meta_code	= 0;
+	uint16_t v[5];
+	uint32_t cmps[5];
+
+	if (end - p < 2) { return SLIMERROR::ERROR_END; }
+
+	memcpy(&meta_code, p, 2);
+	p += 2;
+
+	SLIM_META_UNPACK(meta_code, channels, v, qnt);
+
+	const uint8_t cm_size = (v[0]>0) + (v[1]>0) + (v[2]>0) + (v[3]>0) + (v[4]>0);
+
+	if (end - p < cm_size) { return SLIMERROR::ERROR_END; }
+
+	const uint32_t st_size = SLIM_STREAM_SIZES(v, p, cmps);
+	p += cm_size;
+
+	if ((size_t)(end - p) < st_size) { return SLIMERROR::ERROR_END; }
+
+	SLIM_DECODE_STREAMS(v, cmps, p, channels, m_data);
+	p += st_size;
+
+	return SLIMERROR::ERROR_OK;
+}
+
+
+template<class StreamT>
+SLIMERROR SLIM_READ_BLOCK(StreamT &infile, uint32_t channels, uint8_t* m_data, uint8_t* m_read, uint32_t &qnt){
+
+	//--------------------------------------------------------------//
+	//Read one block from the stream into the decoder state, streams
+	//that are in memory are decoded in place without the copy
+	//--------------------------------------------------------------//
+
+	size_t available = 0;
+
+	const uint8_t* view = infile.view(available);
+
+	if (view != NULL) {
+		const uint8_t* p = view;
+
+		SLIMERROR res = SLIM_DECODE_BLOCK(p, view + available, channels, m_data, qnt);
+
+		if (res == SLIMERROR::ERROR_OK && !infile.seek((size_t)(p - view), MiniStream::Cur)) { return SLIMERROR::ERROR_END; }
+
+		return res;
+	}
+
+	uint16_t meta_code	= 0;
+	uint16_t v[5];
+	uint8_t	 m_size[5];
+	uint32_t cmps[5];
+
+	if (!infile.read(&meta_code, 1, 2)){ return SLIMERROR::ERROR_END; }
+
+	SLIM_META_UNPACK(meta_code, channels, v, qnt);
+
+	const uint8_t cm_size = (v[0]>0) + (v[1]>0) + (v[2]>0) + (v[3]>0) + (v[4]>0);
+
+	if (!infile.read(m_size, 1, cm_size)){ return SLIMERROR::ERROR_END; }
+
+	const uint32_t st_size = SLIM_STREAM_SIZES(v, m_size, cmps);
+
+	if (!infile.read(m_read, 1, st_size)){ return SLIMERROR::ERROR_END; }
+
+	SLIM_DECODE_STREAMS(v, cmps, m_read, channels, m_data);
+
+	return SLIMERROR::ERROR_OK;
+}
+
+
+
+
+void SLIM_PUT_RECT(const uint8_t* m_data, uint32_t channels, uint32_t qnt, uint32_t bw, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1, uint8_t* dst, size_t stride, uint32_t step = 1){
+
+	//--------------------------------------------------------------//
+	//Expand pixels [x0,x1) x [y0,y1) of a decoded block that is bw
+	//pixels wide, dst points to the pixel at x0, y0. With step > 1
+	//only every step-th pixel of every step-th row is written.
+	//--------------------------------------------------------------//
+
+	const uint8_t* m_idx = m_data + 256u * channels;
+
+	for (uint32_t y = y0; y < y1; y += step, dst += stride)
+	{
+		uint8_t* px		= dst;
+		uint32_t Cout	= y * bw + x0;
+
+		for (uint32_t x = x0; x < x1; x += step, px += channels, Cout += step)
+		{
+			const uint32_t idxclr = m_idx[Cout];
+
+			uint8_t chn0	= m_data[idxclr];
+			uint8_t chn1 	= m_data[idxclr + 256];
+			uint8_t chn2 	= m_data[idxclr + 512];
+
+			if (channels == 4) {
+				uint8_t chn3 = m_data[idxclr + 768];
+
+				if (qnt > 0 && chn3 > 0) {
+					double pnl = perlin_noise_frame[Cout];
+					chn0 = perlin_pixel(chn0, qnt, pnl);
+					chn1 = perlin_pixel(chn1, qnt, pnl);
+					chn2 = perlin_pixel(chn2, qnt, pnl);
+					chn3 = perlin_pixel(chn3, qnt, pnl);
+				}
+
+				px[3] = chn3;
+			}
+			else if (qnt > 0) {
+				double pnl = perlin_noise_frame[Cout];
+				chn0 = perlin_pixel(chn0, qnt, pnl);
+				chn1 = perlin_pixel(chn1, qnt, pnl);
+				chn2 = perlin_pixel(chn2, qnt, pnl);
+			}
+
+			px[0] = chn0;
+			px[1] = chn1;
+			px[2] = chn2;
+		}
+	}
+}
+
+
+void SLIM_PUT_BLOCK(const uint8_t* m_data, uint32_t channels, uint32_t qnt, uint8_t* dst, size_t stride, uint32_t bw, uint32_t bh){
+	SLIM_PUT_RECT(m_data, channels, qnt, bw, 0, 0, bw, bh, dst, stride);
+}
+
+
+//Decoder state carried from one block row to the next
+struct		SLIM_READ_STATE {
+
+	uint8_t					m_data	[1280];	//Curret block memory
+	uint32_t				qnt;
+	uint32_t				block;			//Block number
+};
+
+
+template<class StreamT>
+SLIMERROR SLIM_READ_STRIP(StreamT &infile, SLIM_INFO &header, uint32_t channels, uint8_t* rows, size_t stride, uint32_t bh, SLIM_READ_STATE &state) {
+
+	//--------------------------------------------------------------//
+	//Decodes one row of blocks into bh image rows starting at rows
+	//--------------------------------------------------------------//
+
+	const uint32_t m_WIDTH	= (uint32_t)header._WIDTH;
+
+	uint8_t m_read		[1280]{0};	//Read		block memory
+
+	for (uint32_t blcX = 0; blcX < m_WIDTH; blcX += 16, ++state.block)
+	{
+		if (header._RESTART > 0 && state.block % header._RESTART == 0) { memset(state.m_data, 0, sizeof(state.m_data)); }
+
+		SLIMERROR res = SLIM_READ_BLOCK(infile, channels, state.m_data, m_read, state.qnt);
+
+		if (res != SLIMERROR::ERROR_OK) { return res; }
+
+		SLIM_PUT_BLOCK(state.m_data, channels, state.qnt, rows + (size_t)blcX * channels, stride, std::min(16u, m_WIDTH - blcX), bh);
+	}
+
+	return SLIMERROR::ERROR_OK;
+}
+
+
+template<class StreamT>
+SLIMERROR SLIM_READ_BLOCKS(StreamT &infile, SLIM_INFO &header, uint8_t* &img, uint32_t channels) {
+
+	const uint32_t m_WIDTH	= (uint32_t)header._WIDTH;
+	const uint32_t m_HEIGHT = (uint32_t)header._HEIGHT;
+	const size_t   stride	= (size_t)m_WIDTH * channels;
+
+	img = (uint8_t*)SLIM_MALLOC(stride * m_HEIGHT);
+
+	if (img == NULL) { return SLIMERROR::ERROR_MEM; }
+
+	SLIM_READ_STATE state{};
+
+	for (uint32_t blcY = 0; blcY < m_HEIGHT; blcY += 16)
+	{
+		SLIMERROR res = SLIM_READ_STRIP(infile, header, channels, img + blcY * stride, stride, std::min(16u, m_HEIGHT - blcY), state);
+
+		if (res != SLIMERROR::ERROR_OK) { return res; }
+	}
+
+	return SLIMERROR::ERROR_OK;
+}
+
+
+
+SLIMERROR SLIM_READ_HEADER(MiniStream &infile, SLIM_INFO &header){
+
+	char m_buf[sizeof(MINI_SLIM_HEADER)] = {0};
+
+	if (!infile.read(m_buf, 1, sizeof(MINI_SLIM_HEADER))) 						{ return SLIMERROR::ERROR_BLOCK; }
+
+	if (strncmp(m_buf, MINI_SLIM_HEADER, sizeof(MINI_SLIM_HEADER))) 			{ return SLIMERROR::ERROR_NOTSUP; }
+
+	if (!infile.read(reinterpret_cast<char*>(&header), 1, SLIM_INFO_SIZE)) 		{ return SLIMERROR::ERROR_BLOCK; }
+
+	if (header._VERS < uint32_t(SLIM_VER_MIN) || header._VERS > uint32_t(SLIM_VER)) { return SLIMERROR::ERROR_NOTSUP; }
+	if (header._WIDTH == 0 || header._HEIGHT == 0) 								{ return SLIMERROR::ERROR_BLOCK; }
+
+	//Before 1.3.0.0 the flags byte was struct padding
+	if (header._VERS < uint32_t((1 << 24) | (3 << 16))) { header._FLAGS = FLAG_NONE; }
+
+	if (header._FLAGS & ~SLIM_FLAG_MASK) 										{ return SLIMERROR::ERROR_NOTSUP; }
+
+	header._EFFORT	= SLIM_EFFORT_DEFAULT;
+	header._RESTART = 0;
+
+	if (header._FLAGS & FLAG_RESTART) {
+		if (!infile.read(&header._RESTART, 4, 1)) 								{ return SLIMERROR::ERROR_BLOCK; }
+		if (header._RESTART == 0) 												{ return SLIMERROR::ERROR_DATA; }
+	}
+
+	header._MIPS = 0;
+
+	if (header._FLAGS & FLAG_MIP) {
+		if (!infile.read(&header._MIPS, 4, 1)) 									{ return SLIMERROR::ERROR_BLOCK; }
+		if (header._MIPS == 0 || header._MIPS > SLIM_MIP_LEVELS(header._WIDTH, header._HEIGHT)) { return SLIMERROR::ERROR_DATA; }
+	}
+
+	header._LAYERS = 0;
+
+	if (header._FLAGS & FLAG_LAYERS) {
+		if (header._FLAGS & FLAG_MIP) 											{ return SLIMERROR::ERROR_DATA; }
+		if (!infile.read(&header._LAYERS, 4, 1)) 								{ return SLIMERROR::ERROR_BLOCK; }
+		if (header._LAYERS == 0) 												{ return SLIMERROR::ERROR_DATA; }
+
+		//Skip the layer directory, the header describes layer 0 that follows it
+		if (!infile.setPos(infile.getPos() + (size_t)header._LAYERS * sizeof(SLIM_LAYER))) { return SLIMERROR::ERROR_BLOCK; }
+	}
+
+	return SLIMERROR::ERROR_OK;
+}
+
+
+SLIMERROR SLIM_WRITE_HEADER(MiniStream &outfile, SLIM_INFO &header){
+
+	if (!outfile.write(MINI_SLIM_HEADER, 1,sizeof(MINI_SLIM_HEADER)))			{ return SLIMERROR::ERROR_BLOCK; }
+	if (!outfile.write(reinterpret_cast<char*>(&header), 1, SLIM_INFO_SIZE)) 	{ return SLIMERROR::ERROR_BLOCK; }
+
+	if (header._FLAGS & FLAG_RESTART) {
+		if (!outfile.write(&header._RESTART, 4, 1)) 							{ return SLIMERROR::ERROR_BLOCK; }
+	}
+
+	if (header._FLAGS & FLAG_MIP) {
+		if (!outfile.write(&header._MIPS, 4, 1)) 								{ return SLIMERROR::ERROR_BLOCK; }
+	}
+
+	if (header._FLAGS & FLAG_LAYERS) {
+		if (!outfile.write(&header._LAYERS, 4, 1)) 								{ return SLIMERROR::ERROR_BLOCK; }
+	}
+
+	return SLIMERROR::ERROR_OK;
+}
+
+
+uint32_t SLIM_TAIL_CHUNKS(uint8_t flags){
+
+	return ((flags & FLAG_INDEX) ? 1u : 0u) + ((flags & FLAG_MIP) ? 1u : 0u) + ((flags & FLAG_STATS) ? 1u : 0u);
+}
+
+
+SLIMERROR SLIM_WRITE_CHUNK(MiniStream &outfile, uint32_t tag, const void* data, uint32_t size){
+
+	SLIM_CHUNK chunk;
+	chunk._TAG	= tag;
+	chunk._SIZE	= size;
+
+	if (size > 0 && !outfile.write(data, 1, size)) 	{ return SLIMERROR::ERROR_BLOCK; }
+	if (!outfile.write(&chunk, 1, sizeof(SLIM_CHUNK))) { return SLIMERROR::ERROR_BLOCK; }
+
+	return SLIMERROR::ERROR_OK;
+}
+
+
+SLIMERROR SLIM_FIND_CHUNK(MiniStream &infile, uint64_t base, uint8_t flags, uint32_t tag, uint32_t &size){
+
+	//--------------------------------------------------------------//
+	//Walk the tail chunks backwards from the end of the stream
+	//--------------------------------------------------------------//
+
+	uint64_t pos			= infile.size();
+	const uint32_t chunks	= SLIM_TAIL_CHUNKS(flags);
+
+	for (uint32_t i = 0; i < chunks; ++i)
+	{
+		SLIM_CHUNK chunk;
+
+		if (pos < base + sizeof(SLIM_CHUNK)) 							{ return SLIMERROR::ERROR_DATA; }
+		pos -= sizeof(SLIM_CHUNK);
+
+		if (!infile.setPos(pos)) 										{ return SLIMERROR::ERROR_FILE; }
+		if (!infile.read(&chunk, 1, sizeof(SLIM_CHUNK))) 				{ return SLIMERROR::ERROR_END; }
+		if (pos < base + chunk._SIZE) 									{ return SLIMERROR::ERROR_DATA; }
+
+		pos -= chunk._SIZE;
+
+		if (chunk._TAG == tag) {
+			size = chunk._SIZE;
+			return infile.setPos(pos) ? SLIMERROR::ERROR_OK : SLIMERROR::ERROR_FILE;
+		}
+	}
+
+	return SLIMERROR::ERROR_NONE;
+}
+
+
+SLIMERROR SLIM_WRITE_INDEX(MiniStream &outfile, SLIM_INDEX &index){
+
+	const uint32_t size = 8u + index._COUNT * 8u;
+
+	uint8_t* data = (uint8_t*)SLIM_MALLOC(size);
+
+	if (data == NULL) { return SLIMERROR::ERROR_MEM; }
+
+	memcpy(data, &index._SEGMENT, 4);
+	memcpy(data + 4, &index._COUNT, 4);
+	memcpy(data + 8, index._OFFSET, index._COUNT * 8u);
+
+	SLIMERROR res = SLIM_WRITE_CHUNK(outfile, SLIM_CHUNK_INDEX, data, size);
+
+	SLIM_FREE(data);
+
+	return res;
+}
+
+
+//Block statistics kept in the stats chunk, in file order
+#define SLIM_STATS_FIELDS(info) { \
+	&(info)._BLOCK_256_ALL, &(info)._BLOCK_256_EXIST, &(info)._BLOCK_256_EMPTY, \
+	&(info)._BLOCK_COLOR_TABLE_MAX, &(info)._BLOCK_COLOR_TABLE_MIN, &(info)._BLOCK_COLOR_TABLE_AVG, \
+	&(info)._BLOCK_Q_MAX, &(info)._BLOCK_Q_MIN, &(info)._BLOCK_Q_AVG, \
+	&(info)._ALL_C, &(info)._REUSE_C, &(info)._ORIGINAL_C, &(info)._RLE_C, &(info)._RICE_C, &(info)._SLDD_C, &(info)._MASKARED_C }
+
+#define SLIM_STATS_COUNT	16u
+
+
+SLIMERROR SLIM_WRITE_STATS(MiniStream &outfile, SLIM_INFO_FULL &info){
+
+	uint32_t* fields[SLIM_STATS_COUNT] = SLIM_STATS_FIELDS(info);
+	uint32_t  data[SLIM_STATS_COUNT];
+
+	for (uint32_t i = 0; i < SLIM_STATS_COUNT; ++i) { data[i] = *fields[i]; }
+
+	return SLIM_WRITE_CHUNK(outfile, SLIM_CHUNK_STATS, data, sizeof(data));
+}
+
+
+SLIMERROR SLIM_READ_STATS(MiniStream &infile, uint64_t base, uint8_t flags, SLIM_INFO_FULL &info){
+
+	//--------------------------------------------------------------//
+	//Fill the block statistics from the stats chunk, ERROR_NONE if
+	//the file has none
+	//--------------------------------------------------------------//
+
+	if (!(flags & FLAG_STATS)) { return SLIMERROR::ERROR_NONE; }
+
+	uint32_t size = 0;
+	uint32_t data[SLIM_STATS_COUNT];
+
+	SLIMERROR res = SLIM_FIND_CHUNK(infile, base, flags, SLIM_CHUNK_STATS, size);
+
+	if (res != SLIMERROR::ERROR_OK) { return res; }
+
+	if (size != sizeof(data)) 				{ return SLIMERROR::ERROR_DATA; }
+	if (!infile.read(data, 4, SLIM_STATS_COUNT)) { return SLIMERROR::ERROR_END; }
+
+	uint32_t* fields[SLIM_STATS_COUNT] = SLIM_STATS_FIELDS(info);
+
+	for (uint32_t i = 0; i < SLIM_STATS_COUNT; ++i) { *fields[i] = data[i]; }
+
+	return SLIMERROR::ERROR_OK;
+}
+
+
+SLIM_INFO Create_Info(uint16_t w, uint16_t h, uint8_t code, uint8_t filter, uint8_t level, uint8_t flags, uint32_t restart, uint32_t mips, uint8_t effort){
+
+	SLIM_INFO tmp;
+	tmp._VERS = SLIM_VER;
+	tmp._WIDTH = w;
+	tmp._HEIGHT = h;
+	tmp._CODE = code;
+	tmp._FILTER = filter;
+	tmp._LEVEL = level;
+	tmp._FLAGS = flags & ~(FLAG_RESTART | FLAG_MIP | FLAG_LAYERS);
+	tmp._RESTART = 0;
+	tmp._MIPS = 0;
+	tmp._LAYERS = 0;
+	tmp._EFFORT = std::min<uint8_t>(effort, SLIM_EFFORT_MAX);
+
+	if (restart == SLIM_RESTART_ROW) { restart = ((uint32_t)w + 15u) >> 4; }
+
+	if (restart > 0) {
+		tmp._FLAGS		|= FLAG_RESTART;
+		tmp._RESTART	= restart;
+	}
+
+	mips = std::min(mips, SLIM_MIP_LEVELS(w, h));
+
+	if (mips > 0) {
+		tmp._FLAGS		|= FLAG_MIP;
+		tmp._MIPS		= mips;
+	}
+
+	return tmp;
+}
+
+
+template<class StreamT>
+SLIMERROR SLIM_ENCODE_BLOCKS(StreamT &outfile, SLIM_INFO &header, uint8_t* &img, uint32_t channels, SLIM_INDEX* index, SLIM_INFO_FULL* info, MiniPool* pool){
+
+	if (pool == NULL) { return SLIM_WRITE_BLOCKS(outfile, header, img, channels, index, info); }
+
+	return SLIM_WRITE_BLOCKS_PARALLEL(outfile, header, img, channels, index, info, *pool);
+}
+
+
+SLIMERROR SLIM_WRITE_MIPS(MiniStream &outfile, SLIM_INFO &header, uint8_t* img, uint32_t channels, uint64_t base, MiniPool* pool){
+
+	//--------------------------------------------------------------//
+	//Every level is a plain block stream without restarts and index,
+	//the MIP chunk keeps where each of them starts
+	//--------------------------------------------------------------//
+
+	const uint32_t levels	= header._MIPS;
+	const uint32_t size		= 4u + levels * 8u;
+
+	const size_t first		= (size_t)SLIM_MIP_SIZE(header._WIDTH, 1) * SLIM_MIP_SIZE(header._HEIGHT, 1) * channels;
+	const size_t second		= (size_t)SLIM_MIP_SIZE(header._WIDTH, 2) * SLIM_MIP_SIZE(header._HEIGHT, 2) * channels;
+
+	uint8_t* data	= (uint8_t*)SLIM_MALLOC(size);
+	uint8_t* buf[2]	= {(uint8_t*)SLIM_MALLOC(first), (uint8_t*)SLIM_MALLOC(second)};
+
+	SLIMERROR res = SLIMERROR::ERROR_OK;
+
+	if (data == NULL || buf[0] == NULL || buf[1] == NULL) { res = SLIMERROR::ERROR_MEM; }
+
+	uint8_t* src = img;
+
+	if (data != NULL) { memcpy(data, &levels, 4); }
+
+	for (uint32_t l = 1; l <= levels && res == SLIMERROR::ERROR_OK; ++l)
+	{
+		SLIM_INFO level = header;
+
+		level._WIDTH	= SLIM_MIP_SIZE(header._WIDTH, l);
+		level._HEIGHT	= SLIM_MIP_SIZE(header._HEIGHT, l);
+		level._FLAGS	= FLAG_NONE;
+		level._RESTART	= 0;
+		level._MIPS		= 0;
+
+		uint8_t* dst = buf[(l - 1u) & 1u];
+
+		SLIM_MIP_DOWNSAMPLE(src, SLIM_MIP_SIZE(header._WIDTH, l - 1u), SLIM_MIP_SIZE(header._HEIGHT, l - 1u), channels, dst);
+
+		const uint64_t offset = outfile.getPos() - base;
+
+		memcpy(data + 4u + (l - 1u) * 8u, &offset, 8);
+
+		res = SLIM_ENCODE_BLOCKS(outfile, level, dst, channels, NULL, NULL, pool);
+
+		src = dst;
+	}
+
+	if (res == SLIMERROR::ERROR_OK) { res = SLIM_WRITE_CHUNK(outfile, SLIM_CHUNK_MIP, data, size); }
+
+	if (data != NULL)	{ SLIM_FREE(data); }
+	if (buf[0] != NULL)	{ SLIM_FREE(buf[0]); }
+	if (buf[1] != NULL)	{ SLIM_FREE(buf[1]); }
+
+	return res;
+}
+
+
+SLIMERROR SLIM_CHECK_HEADER(SLIM_INFO &header){
+
+	if (header._VERS != uint32_t(SLIM_VER)) 									{ return SLIMERROR::ERROR_NOTSUP; }
+	if (header._WIDTH == 0 || header._HEIGHT == 0) 								{ return SLIMERROR::ERROR_BLOCK; }
+	if (header._FLAGS & ~(SLIM_FLAG_MASK & ~FLAG_LAYERS)) 						{ return SLIMERROR::ERROR_ARG; }
+	if (header._CODE != SLIMCODE::CODE_RGB && header._CODE != SLIMCODE::CODE_RGBA) { return SLIMERROR::ERROR_BLOCK; }
+	if ((header._FLAGS & FLAG_RESTART) && header._RESTART == 0) 				{ return SLIMERROR::ERROR_ARG; }
+	if ((header._FLAGS & FLAG_MIP) && (header._MIPS == 0 || header._MIPS > SLIM_MIP_LEVELS(header._WIDTH, header._HEIGHT))) { return SLIMERROR::ERROR_ARG; }
+
+	return SLIMERROR::ERROR_OK;
+}
+
+
+SLIMERROR SLIM_ALLOC_INDEX(SLIM_INFO &header, SLIM_INDEX &index){
+
+	//One index entry per restart interval, or per block row without restarts
+
+	const uint32_t blocksX	= ((uint32_t)header._WIDTH + 15u) >> 4;
+	const uint32_t blocksY	= ((uint32_t)header._HEIGHT + 15u) >> 4;
+
+	index._SEGMENT	= 0;
+	index._COUNT	= 0;
+	index._BASE		= 0;
+	index._OFFSET	= NULL;
+
+	if (!(header._FLAGS & FLAG_INDEX)) { return SLIMERROR::ERROR_OK; }
+
+	index._SEGMENT	= (header._FLAGS & FLAG_RESTART) ? header._RESTART : blocksX;
+	index._COUNT	= (blocksX * blocksY + index._SEGMENT - 1u) / index._SEGMENT;
+	index._OFFSET	= (uint64_t*)SLIM_MALLOC(index._COUNT * sizeof(uint64_t));
+
+	return (index._OFFSET == NULL) ? SLIMERROR::ERROR_MEM : SLIMERROR::ERROR_OK;
+}
+
+
+template<class StreamT>
+SLIMERROR SLIM_SAVE(StreamT &outfile, SLIM_INFO &header, uint8_t* &img, SLIM_INFO_FULL* info, unsigned threads){
+
+	if (!outfile.isOpen()){return SLIMERROR::ERROR_FILE;}
+	if (img == NULL){return SLIMERROR::ERROR_ARG;}
+
+	SLIMERROR res = SLIM_CHECK_HEADER(header);
+
+	if (res != SLIMERROR::ERROR_OK) { return res; }
+
+	SLIM_INDEX index;
+
+	res = SLIM_ALLOC_INDEX(header, index);
+
+	if (res != SLIMERROR::ERROR_OK) { return res; }
+
+	//The stats chunk needs the statistics even if the caller does not
+	SLIM_INFO_FULL stats;
+
+	if (info == NULL && (header._FLAGS & FLAG_STATS)) { info = &stats; }
+
+	if (info != NULL) { SLIM_INFO_CLEAR(*info, header); }
+
+	res = SLIM_WRITE_HEADER(outfile, header);
+
+	if (res == SLIMERROR::ERROR_OK) {
+		SLIM_INDEX* pindex = (index._OFFSET != NULL) ? &index : NULL;
+
+		const uint32_t channels = (header._CODE == SLIMCODE::CODE_RGBA) ? 4u : 3u;
+		const uint64_t base		= outfile.getPos();
+
+		std::unique_ptr<MiniPool> pool;
+
+		if (threads != 1) { pool.reset(new MiniPool(threads)); }
+
+		res = SLIM_ENCODE_BLOCKS(outfile, header, img, channels, pindex, info, pool.get());
+
+		if (res == SLIMERROR::ERROR_OK && (header._FLAGS & FLAG_MIP)) { res = SLIM_WRITE_MIPS(outfile, header, img, channels, base, pool.get()); }
+
+		if (res == SLIMERROR::ERROR_OK && pindex != NULL) { res = SLIM_WRITE_INDEX(outfile, index); }
+	}
+
+	if (info != NULL) { SLIM_INFO_FINISH(*info); }
+
+	if (res == SLIMERROR::ERROR_OK && (header._FLAGS & FLAG_STATS)) { res = SLIM_WRITE_STATS(outfile, *info); }
+
+	Free_Index(index);
+
+	return res;
+}
+
+
+SLIMERROR Save_SLIM(MiniStream &outfile, SLIM_INFO &header, uint8_t* &img, SLIM_INFO_FULL* info){
+	return SLIM_SAVE<MiniStream>(outfile, header, img, info, 1);
+}
+
+
+template<class StreamT>
+SLIMERROR Save_SLIM(StreamT &outfile, SLIM_INFO &header, uint8_t* &img, SLIM_INFO_FULL* info){
+	return SLIM_SAVE<StreamT>(outfile, header, img, info, 1);
+}
+
+
+SLIMERROR Save_SLIM_Parallel(MiniStream &outfile, SLIM_INFO &header, uint8_t* &img, unsigned threads, SLIM_INFO_FULL* info){
+	return SLIM_SAVE<MiniStream>(outfile, header, img, info, threads);
+}
+
+
+template<class StreamT>
+SLIMERROR Save_SLIM_Parallel(StreamT &outfile, SLIM_INFO &header, uint8_t* &img, unsigned threads, SLIM_INFO_FULL* info){
+	return SLIM_SAVE<StreamT>(outfile, header, img, info, threads);
+}
+
+
+//--------------------------------------------------------------//
+//Strip encoder: the image is pushed one row of blocks at a time,
+//so only the current strip has to be in memory. The output is the
+//same as Save_SLIM. MIP levels need the whole image and are not
+//supported here.
+//--------------------------------------------------------------//
+
+class		SLIM_ENCODER {
+
+public:
+
+	SLIM_ENCODER() : m_out(NULL), m_info(NULL), m_channels(0), m_row(0) {
+		m_index._OFFSET = NULL;
+	}
+
+	~SLIM_ENCODER() { Free_Index(m_index); }
+
+	SLIM_ENCODER(const SLIM_ENCODER&) = delete;
+	SLIM_ENCODER& operator=(const SLIM_ENCODER&) = delete;
+
+	//Validates the header and writes it, info receives the statistics
+	SLIMERROR begin(MiniStream &outfile, SLIM_INFO &header, SLIM_INFO_FULL* info = NULL){
+
+		if (m_out != NULL) { return SLIMERROR::ERROR_ARG; }
+		if (!outfile.isOpen()) { return SLIMERROR::ERROR_FILE; }
+
+		SLIMERROR res = SLIM_CHECK_HEADER(header);
+
+		if (res != SLIMERROR::ERROR_OK) { return res; }
+		if (header._FLAGS & FLAG_MIP) { return SLIMERROR::ERROR_NOTSUP; }
+
+		Free_Index(m_index);
+
+		res = SLIM_ALLOC_INDEX(header, m_index);
+
+		if (res != SLIMERROR::ERROR_OK) { return res; }
+
+		m_header	= header;
+		m_info		= info;
+		m_channels	= (header._CODE == SLIMCODE::CODE_RGBA) ? 4u : 3u;
+		m_row		= 0;
+		m_state		= SLIM_WRITE_STATE{};
+
+		SLIM_REUSE_RESET(m_state.m_data);
+		SLIM_REUSE_RESET(m_state.c_data);
+
+		//The stats chunk needs the statistics even if the caller does not
+		if (m_info == NULL && (header._FLAGS & FLAG_STATS)) { m_info = &m_stats; }
+
+		if (m_info != NULL) { SLIM_INFO_CLEAR(*m_info, m_header); }
+
+		res = SLIM_WRITE_HEADER(outfile, m_header);
+
+		if (res != SLIMERROR::ERROR_OK) { Free_Index(m_index); return res; }
+
+		m_out = &outfile;
+
+		return SLIMERROR::ERROR_OK;
+	}
+
+	//Encodes the next row of blocks: count must be 16 rows, or the
+	//rest of the image for the last strip. stride - bytes per row
+	SLIMERROR push_rows(const uint8_t* rows, size_t stride, uint32_t count){
+
+		if (m_out == NULL || rows == NULL) { return SLIMERROR::ERROR_ARG; }
+		if (m_row >= m_header._HEIGHT) { return SLIMERROR::ERROR_END; }
+		if (count != std::min(16u, (uint32_t)m_header._HEIGHT - m_row)) { return SLIMERROR::ERROR_ARG; }
+		if (stride < (size_t)m_header._WIDTH * m_channels) { return SLIMERROR::ERROR_ARG; }
+
+		SLIM_INDEX* pindex = (m_index._OFFSET != NULL) ? &m_index : NULL;
+
+		SLIMERROR res = SLIM_WRITE_STRIP(*m_out, m_header, rows, stride, count, m_channels, pindex, m_info, m_state);
+
+		//The stream is unusable after a failed strip, begin may start over
+		if (res != SLIMERROR::ERROR_OK) { Free_Index(m_index); m_out = NULL; return res; }
+
+		m_row += count;
+
+		return SLIMERROR::ERROR_OK;
+	}
+
+	//Writes the tail chunks once every row has been pushed
+	SLIMERROR finish(){
+
+		if (m_out == NULL) { return SLIMERROR::ERROR_ARG; }
+		if (m_row != m_header._HEIGHT) { return SLIMERROR::ERROR_END; }
+
+		SLIMERROR res = SLIMERROR::ERROR_OK;
+
+		if (m_index._OFFSET != NULL) { res = SLIM_WRITE_INDEX(*m_out, m_index); }
+
+		if (m_info != NULL) { SLIM_INFO_FINISH(*m_info); }
+
+		if (res == SLIMERROR::ERROR_OK && (m_header._FLAGS & FLAG_STATS)) { res = SLIM_WRITE_STATS(*m_out, *m_info); }
+
+		Free_Index(m_index);
+
+		m_out = NULL;
+
+		return res;
+	}
+
+	//Image rows encoded so far
+	uint32_t rows() const { return m_row; }
+
+private:
+
+	MiniStream*				m_out;
+	SLIM_INFO				m_header;
+	SLIM_INFO_FULL			m_stats;
+	SLIM_INFO_FULL*			m_info;
+	SLIM_INDEX				m_index;
+	SLIM_WRITE_STATE		m_state;
+	uint32_t				m_channels;
+	uint32_t				m_row;
+};
+
+
+SLIMERROR SLIM_READ_INDEX(MiniStream &infile, SLIM_INFO &header, SLIM_INDEX &index){
+
+	//--------------------------------------------------------------//
+	//Expects the stream at the first block, i.e. right after the header
+	//--------------------------------------------------------------//
+
+	index._SEGMENT	= 0;
+	index._COUNT	= 0;
+	index._BASE		= infile.getPos();
+	index._OFFSET	= NULL;
+
+	//Files without an index are decoded sequentially, layered files
+	//keep one index per layer (Open_SLIM_Layers)
+	if (!(header._FLAGS & FLAG_INDEX) || (header._FLAGS & FLAG_LAYERS)) { return SLIMERROR::ERROR_NONE; }
+
+	uint32_t size = 0;
+
+	SLIMERROR res = SLIM_FIND_CHUNK(infile, index._BASE, header._FLAGS, SLIM_CHUNK_INDEX, size);
+
+	if (res != SLIMERROR::ERROR_OK) { infile.setPos(index._BASE); return res; }
+
+	const uint32_t blocks = (((uint32_t)header._WIDTH + 15u) >> 4) * (((uint32_t)header._HEIGHT + 15u) >> 4);
+
+	if (size < 8u || !infile.read(&index._SEGMENT, 4, 1) || !infile.read(&index._COUNT, 4, 1)) {
+		infile.setPos(index._BASE);
+		return SLIMERROR::ERROR_DATA;
+	}
+
+	if (index._SEGMENT == 0 || index._COUNT != (blocks + index._SEGMENT - 1u) / index._SEGMENT || size != 8u + index._COUNT * 8u) {
+		infile.setPos(index._BASE);
+		return SLIMERROR::ERROR_DATA;
+	}
+
+	index._OFFSET = (uint64_t*)SLIM_MALLOC(index._COUNT * sizeof(uint64_t));
+
+	if (index._OFFSET == NULL) { infile.setPos(index._BASE); return SLIMERROR::ERROR_MEM; }
+
+	if (!infile.read(index._OFFSET, 8, index._COUNT)) { Free_Index(index); infile.setPos(index._BASE); return SLIMERROR::ERROR_END; }
+
+	//Leave the stream at the first block
+	return infile.setPos(index._BASE) ? SLIMERROR::ERROR_OK : SLIMERROR::ERROR_FILE;
+}
+
+
+SLIMERROR Index_SLIM(MiniStream &infile, SLIM_INFO &header, SLIM_INDEX &index){
+
+	index._SEGMENT	= 0;
+	index._COUNT	= 0;
+	index._BASE		= 0;
+	index._OFFSET	= NULL;
+
+	if (!infile.isOpen()){return SLIMERROR::ERROR_FILE;}
+
+	SLIMERROR res = SLIM_READ_HEADER(infile, header);
+
+	if (res != SLIMERROR::ERROR_OK) { return res; }
+
+	return SLIM_READ_INDEX(infile, header, index);
+}
+
+
+SLIMERROR Free_Index(SLIM_INDEX &index){
+
+	if (index._OFFSET != NULL) { SLIM_FREE(index._OFFSET); }
+
+	index._OFFSET	= NULL;
+	index._COUNT	= 0;
+
+	return SLIMERROR::ERROR_OK;
+}
+
+
+SLIMERROR SLIM_INFO_SCAN(MiniStream &infile, SLIM_INFO &header, SLIM_INFO_FULL &info, bool colors){
+
+	//--------------------------------------------------------------//
+	//Gather block statistics from the meta codes and stream sizes.
+	//Palette sizes need the index streams, without colors the
+	//payloads are skipped and the color table stats stay 0.
+	//--------------------------------------------------------------//
+
+	const uint32_t m_WIDTH	= (uint32_t)header._WIDTH;
+	const uint32_t m_HEIGHT = (uint32_t)header._HEIGHT;
+	const uint32_t channels	= (header._CODE == SLIMCODE::CODE_RGBA) ? 4u : 3u;
+
+	uint8_t m_data		[1280]{0};	//Curret	block memory
+	uint8_t m_read		[1280]{0};	//Read		block memory
+	uint8_t m_size		[5]{0};		//Size 		blocks packed
+
+	uint16_t comp_pack[5]{0,0,0,0,0};
+	uint32_t cmps[5];
+	uint32_t qnt 		= 0;
+
+	uint16_t meta_code	= 0;
+
+	for (uint32_t blcY = 0; blcY < m_HEIGHT; blcY += 16)
+	{
+		for (uint32_t blcX = 0; blcX < m_WIDTH; blcX += 16)
+		{
+
+			if (!infile.read(&meta_code, 1, 2)){ return SLIMERROR::ERROR_END; }
+
+			SLIM_META_UNPACK(meta_code, channels, comp_pack, qnt);
+
+			const uint8_t cm_size = (comp_pack[0]>0) + (comp_pack[1]>0) + (comp_pack[2]>0) + (comp_pack[3]>0) + (comp_pack[4]>0);
+
+			if (!infile.read(m_size, 1, cm_size)){ return SLIMERROR::ERROR_END; }
+
+			const uint32_t st_size	= SLIM_STREAM_SIZES(comp_pack, m_size, cmps);
+			const uint32_t st_idx	= st_size - cmps[4];
+
+			uint32_t palette = 0;
+
+			if (!colors) {
+				if (!infile.setPos(infile.getPos() + st_size)){ return SLIMERROR::ERROR_END; }
+			}
+			else {
+				if (!infile.read(m_read, 1, st_size)){ return SLIMERROR::ERROR_END; }
+
+				uint8_t* m_idx = m_data + 256u * channels;
+
+				DECODE_REVOLVER(comp_pack[4], m_read + st_idx, m_idx, cmps[4]);
+
+				//Palette size is the largest index of the block pixels
+				const uint32_t Cout	= std::min(16u, m_WIDTH - blcX) * std::min(16u, m_HEIGHT - blcY);
+
+				if(comp_pack[4]){
+					for(uint32_t idx = 0; idx<Cout; ++idx){
+						uint32_t idxclr = m_idx[idx]+1;
+						if(palette<idxclr){palette=idxclr;}
+					}
+				}
+			}
+
+			SLIM_INFO_ADD_BLOCK(info, comp_pack, qnt, palette);
+		}
+	}
+
+	SLIM_INFO_FINISH(info);
+
+	if (!colors) {
+		info._BLOCK_COLOR_TABLE_MAX = 0;
+		info._BLOCK_COLOR_TABLE_MIN = 0;
+		info._BLOCK_COLOR_TABLE_AVG = 0;
+	}
+
+	return  SLIMERROR::ERROR_OK;
+}
+
+
+SLIMERROR SLIM_INFO_READ(MiniStream &infile, SLIM_INFO_FULL &info, bool colors){
+
+	if (!infile.isOpen()){return SLIMERROR::ERROR_FILE;}
+
+	SLIM_INFO header;
+
+	SLIMERROR res = SLIM_READ_HEADER(infile, header);
+
+	if (res != SLIMERROR::ERROR_OK) { return res; }
+
+	SLIM_INFO_CLEAR(info, header);
+
+	const uint64_t base = infile.getPos();
+
+	//Files written with the stats chunk answer without reading blocks
+	res = SLIM_READ_STATS(infile, base, header._FLAGS, info);
+
+	if (res == SLIMERROR::ERROR_OK) { return res; }
+
+	SLIM_INFO_CLEAR(info, header);
+
+	if (!infile.setPos(base)) { return SLIMERROR::ERROR_FILE; }
+
+	return SLIM_INFO_SCAN(infile, header, info, colors);
+}
+
+
+SLIMERROR Info_SLIM(MiniStream &infile, SLIM_INFO_FULL &info){
+	return SLIM_INFO_READ(infile, info, true);
+}
+
+
+SLIMERROR Info_SLIM_Fast(MiniStream &infile, SLIM_INFO_FULL &info){
+	return SLIM_INFO_READ(infile, info, false);
+}
+
+
+template<class StreamT>
+SLIMERROR SLIM_LOAD(StreamT &infile, SLIM_INFO &header, uint8_t* &img){
+
+	if (!infile.isOpen()){return SLIMERROR::ERROR_FILE;}
+
+	SLIMERROR res = SLIM_READ_HEADER(infile, header);
+
+	if (res != SLIMERROR::ERROR_OK) { return res; }
+
+	switch (header._CODE)
+	{
+	case SLIMCODE::CODE_RGB:
+		res = SLIM_READ_BLOCKS(infile, header, img, 3);
+		break;
+	case SLIMCODE::CODE_RGBA:
+		res = SLIM_READ_BLOCKS(infile, header, img, 4);
+		break;
+	default:
+		return SLIMERROR::ERROR_BLOCK;
+	}
+
+	return res;
+}
+
+
+SLIMERROR Load_SLIM(MiniStream &infile, SLIM_INFO &header, uint8_t* &img){
+	return SLIM_LOAD<MiniStream>(infile, header, img);
+}
+
+
+template<class StreamT>
+SLIMERROR Load_SLIM(StreamT &infile, SLIM_INFO &header, uint8_t* &img){
+	return SLIM_LOAD<StreamT>(infile, header, img);
+}
+
+
+
+SLIMERROR Load_SLIM_Strips(MiniStream &infile, SLIM_INFO &header, SLIM_STRIP_CALLBACK on_strip){
+
+	//--------------------------------------------------------------//
+	//Decodes one row of blocks at a time into a single strip buffer
+	//and hands every finished strip to on_strip
+	//--------------------------------------------------------------//
+
+	if (!infile.isOpen()){return SLIMERROR::ERROR_FILE;}
+	if (!on_strip){return SLIMERROR::ERROR_ARG;}
+
+	SLIMERROR res = SLIM_READ_HEADER(infile, header);
+
+	if (res != SLIMERROR::ERROR_OK) { return res; }
+
+	if (header._CODE != SLIMCODE::CODE_RGB && header._CODE != SLIMCODE::CODE_RGBA) { return SLIMERROR::ERROR_BLOCK; }
+
+	const uint32_t channels = (header._CODE == SLIMCODE::CODE_RGBA) ? 4u : 3u;
+	const uint32_t m_WIDTH	= (uint32_t)header._WIDTH;
+	const uint32_t m_HEIGHT = (uint32_t)header._HEIGHT;
+	const size_t   stride	= (size_t)m_WIDTH * channels;
+
+	uint8_t* strip = (uint8_t*)SLIM_MALLOC(stride * 16u);
+
+	if (strip == NULL) { return SLIMERROR::ERROR_MEM; }
+
+	SLIM_READ_STATE state{};
+
+	for (uint32_t blcY = 0; blcY < m_HEIGHT && res == SLIMERROR::ERROR_OK; blcY += 16)
+	{
+		const uint32_t rows = std::min(16u, m_HEIGHT - blcY);
+
+		res = SLIM_READ_STRIP(infile, header, channels, strip, stride, rows, state);
+
+		if (res == SLIMERROR::ERROR_OK) { on_strip(blcY, rows, strip, stride); }
+	}
+
+	SLIM_FREE(strip);
+
+	return res;
+}
+
+
+
+SLIMERROR SLIM_READ_SEGMENTS(MiniStream &infile, SLIM_INFO &header, const SLIM_INDEX &index, uint32_t channels, uint8_t* &img, unsigned threads){
+
+	//--------------------------------------------------------------//
+	//Decode every restart segment of the index on the pool, the
+	//index segment must match the restart interval
+	//--------------------------------------------------------------//
+
+	const uint32_t m_WIDTH	= (uint32_t)header._WIDTH;
+	const uint32_t m_HEIGHT = (uint32_t)header._HEIGHT;
+	const uint32_t blocksX	= (m_WIDTH + 15u) >> 4;
+	const uint32_t blocks	= blocksX * ((m_HEIGHT + 15u) >> 4);
+	const size_t   stride	= (size_t)m_WIDTH * channels;
+	const uint64_t end		= infile.size() - index._BASE;
+
+	img = (uint8_t*)SLIM_MALLOC(stride * m_HEIGHT);
+
+	if (img == NULL) { return SLIMERROR::ERROR_MEM; }
+
+	SLIMERROR res = SLIMERROR::ERROR_OK;
+
+	MiniPool pool(threads);
+
+	std::vector<std::vector<uint8_t>> buffers(pool.size());
+	std::mutex lock;
+
+	//Memory backed streams are decoded in place
+	size_t available = 0;
+
+	const uint8_t* view = infile.setPos(index._BASE) ? infile.view(available) : NULL;
+
+	if (available < end) { view = NULL; }
+
+	pool.run(index._COUNT, [&](uint32_t seg, uint32_t worker) {
+
+		const uint32_t first	= seg * index._SEGMENT;
+		const uint32_t last		= std::min(blocks, first + index._SEGMENT);
+
+		uint64_t from	= index._OFFSET[seg];
+		uint64_t to		= (seg + 1u < index._COUNT) ? index._OFFSET[seg + 1u] : std::min<uint64_t>(end, from + (uint64_t)(last - first) * SLIM_BLOCK_MAX);
+
+		SLIMERROR err = SLIMERROR::ERROR_OK;
+
+		if (from > to || to > end) { err = SLIMERROR::ERROR_DATA; }
+
+		std::vector<uint8_t> &buf = buffers[worker];
+
+		const uint8_t* ptr		= NULL;
+		const uint8_t* ptr_end	= NULL;
+
+		//Offsets from a damaged index must not reach pointer arithmetic
+		if (err == SLIMERROR::ERROR_OK && view != NULL) {
+			ptr		= view + from;
+			ptr_end	= view + to;
 		}
-	}
-	return SLIMERROR::ERROR_OK;
+
+		if (err == SLIMERROR::ERROR_OK && view == NULL) {
+			buf.resize((size_t)(to - from));
+
+			std::lock_guard<std::mutex> guard(lock);
+			if (res != SLIMERROR::ERROR_OK) { return; }
+			if (!infile.setPos(index._BASE + from) || (buf.size() > 0 && !infile.read(buf.data(), 1, buf.size()))) { err = SLIMERROR::ERROR_END; }
+
+			ptr		= buf.data();
+			ptr_end	= ptr + buf.size();
+		}
+
+		uint8_t m_data[1280]{0};	//Segment state starts empty
+		uint32_t qnt = 0;
+
+		for (uint32_t block = first; block < last && err == SLIMERROR::ERROR_OK; ++block)
+		{
+			err = SLIM_DECODE_BLOCK(ptr, ptr_end, channels, m_data, qnt);
+
+			if (err != SLIMERROR::ERROR_OK) { break; }
+
+			const uint32_t blcX = (block % blocksX) << 4;
+			const uint32_t blcY = (block / blocksX) << 4;
+
+			SLIM_PUT_BLOCK(m_data, channels, qnt, img + blcY * stride + (size_t)blcX * channels, stride, std::min(16u, m_WIDTH - blcX), std::min(16u, m_HEIGHT - blcY));
+		}
+
+		if (err != SLIMERROR::ERROR_OK) {
+			std::lock_guard<std::mutex> guard(lock);
+			if (res == SLIMERROR::ERROR_OK) { res = err; }
+		}
+	});
+
+	return res;
 }
 
 
+template<class StreamT>
+SLIMERROR SLIM_LOAD_PARALLEL(StreamT &infile, SLIM_INFO &header, uint8_t* &img, unsigned threads){
 
+	//--------------------------------------------------------------//
+	//Restart segments do not share palette state, so every segment
+	//found in the block index can be decoded on its own thread.
+	//Files without restarts or index are decoded sequentially.
+	//--------------------------------------------------------------//
 
-double perlin_noise_frame[256]{
-0.5, 0.690001, 0.721901, 0.53222, 0.349121, 0.257248, 0.43148, 0.60899, 0.75, 0.60899, 0.445526, 0.473264, 0.573242, 0.46778, 0.278099, 0.309999, 
-0.566247, 0.663996, 0.571459, 0.342413, 0.199621, 0.273598, 0.515754, 0.649168, 0.833123, 0.785823, 0.633541, 0.61574, 0.6523, 0.534027, 0.344346, 0.376246, 
-0.450104, 0.423416, 0.422669, 0.309194, 0.201296, 0.33662, 0.467968, 0.443078, 0.654804, 0.788916, 0.663064, 0.590787, 0.551481, 0.417883, 0.228203, 0.260103, 
-0.469859, 0.403806, 0.51863, 0.49793, 0.39458, 0.495199, 0.524027, 0.403931, 0.501594, 0.598633, 0.476746, 0.481536, 0.549557, 0.437639, 0.247958, 0.279858, 
-0.573242, 0.52097, 0.679409, 0.680848, 0.577637, 0.677615, 0.705353, 0.566797, 0.5, 0.433203, 0.299491, 0.438268, 0.692884, 0.618701, 0.425417, 0.423742, 
-0.473264, 0.455526, 0.718483, 0.772295, 0.66951, 0.769488, 0.797226, 0.649709, 0.5, 0.350291, 0.210568, 0.416959, 0.765737, 0.711214, 0.552636, 0.489614, 
-0.445526, 0.401419, 0.584567, 0.598388, 0.495277, 0.595256, 0.622993, 0.492471, 0.5, 0.507529, 0.379206, 0.457371, 0.627576, 0.538073, 0.482014, 0.529799, 
-0.569366, 0.48351, 0.498379, 0.421648, 0.321869, 0.442154, 0.484472, 0.368035, 0.5, 0.631965, 0.512665, 0.489353, 0.518238, 0.400889, 0.429823, 0.643132, 
-0.5, 0.516876, 0.4547, 0.281735, 0.202637, 0.430729, 0.550461, 0.430634, 0.5, 0.569366, 0.445526, 0.473264, 0.573242, 0.470414, 0.518906, 0.771245, 
-0.430634, 0.601006, 0.615427, 0.423217, 0.33623, 0.527608, 0.620976, 0.493234, 0.5, 0.506766, 0.378388, 0.457175, 0.628247, 0.539313, 0.530374, 0.668105, 
-0.554474, 0.738375, 0.769251, 0.58566, 0.470851, 0.504591, 0.48618, 0.371661, 0.504013, 0.631838, 0.511846, 0.489157, 0.518908, 0.401306, 0.378823, 0.493614, 
-0.526736, 0.570806, 0.578205, 0.53421, 0.481852, 0.36694, 0.274209, 0.280054, 0.596007, 0.803657, 0.680484, 0.529569, 0.380748, 0.226309, 0.141298, 0.225089, 
-0.426758, 0.276093, 0.250797, 0.401208, 0.4768, 0.357735, 0.307171, 0.454365, 0.724121, 0.741051, 0.591561, 0.508259, 0.4536, 0.317116, 0.145025, 0.185646, 
-0.530141, 0.340708, 0.308621, 0.497925, 0.603555, 0.504002, 0.47594, 0.635796, 0.749445, 0.581701, 0.416322, 0.465794, 0.596646, 0.498063, 0.309224, 0.340983, 
-0.549896, 0.430417, 0.375332, 0.518248, 0.644505, 0.597325, 0.529271, 0.604935, 0.681198, 0.553056, 0.393366, 0.402241, 0.551129, 0.53541, 0.450133, 0.464475, 
-0.433753, 0.453874, 0.352895, 0.403238, 0.570657, 0.627995, 0.480133, 0.402954, 0.545002, 0.636284, 0.498129, 0.311498, 0.336932, 0.454374, 0.575767, 0.555351
-};
+	if (!infile.isOpen()){return SLIMERROR::ERROR_FILE;}
 
-uint8_t perlin_pixel(uint8_t cut, uint32_t qnt, double noise){
-	uint32_t a = qnt - 1;
-    uint32_t b = 255 - cut * qnt;
-    uint32_t c = (uint32_t)(cut * qnt + ((double)(a < b ? a : b) * noise));
-    return (uint8_t)(c > 255 ? 255 : c);
+	SLIMERROR res = SLIM_READ_HEADER(infile, header);
+
+	if (res != SLIMERROR::ERROR_OK) { return res; }
+
+	uint32_t channels;
+
+	switch (header._CODE)
+	{
+	case SLIMCODE::CODE_RGB:	channels = 3; break;
+	case SLIMCODE::CODE_RGBA:	channels = 4; break;
+	default:
+		return SLIMERROR::ERROR_BLOCK;
+	}
+
+	SLIM_INDEX index;
+
+	res = SLIM_READ_INDEX(infile, header, index);
+
+	if (res != SLIMERROR::ERROR_OK || !(header._FLAGS & FLAG_RESTART) || index._SEGMENT != header._RESTART || threads == 1) {
+		Free_Index(index);
+		if (!infile.setPos(index._BASE)) { return SLIMERROR::ERROR_FILE; }
+		return SLIM_READ_BLOCKS(infile, header, img, channels);
+	}
+
+	res = SLIM_READ_SEGMENTS(infile, header, index, channels, img, threads);
+
+	Free_Index(index);
+
+	return res;
+}
+
+
+SLIMERROR Load_SLIM_Parallel(MiniStream &infile, SLIM_INFO &header, uint8_t* &img, unsigned threads){
+	return SLIM_LOAD_PARALLEL<MiniStream>(infile, header, img, threads);
+}
+
+
+template<class StreamT>
+SLIMERROR Load_SLIM_Parallel(StreamT &infile, SLIM_INFO &header, uint8_t* &img, unsigned threads){
+	return SLIM_LOAD_PARALLEL<StreamT>(infile, header, img, threads);
 }
 
 
+SLIMERROR Load_SLIM_Region(MiniStream &infile, SLIM_INFO &header, uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint8_t* out){
+
+	//--------------------------------------------------------------//
+	//Decode the w x h window at x, y into out (w * h * channels).
+	//Blocks before the window are only read to rebuild the reuse
+	//state; with restarts the index lets us seek past them.
+	//--------------------------------------------------------------//
+
+	if (!infile.isOpen()){return SLIMERROR::ERROR_FILE;}
+	if (out == NULL){return SLIMERROR::ERROR_ARG;}
+
+	SLIMERROR res = SLIM_READ_HEADER(infile, header);
+
+	if (res != SLIMERROR::ERROR_OK) { return res; }
+
+	uint32_t channels;
 
-SLIMERROR 	SLIM_READ_BLOCKS_3CHANNEL(MiniStream &infile, SLIM_INFO &header, uint8_t* &img) {
+	switch (header._CODE)
+	{
+	case SLIMCODE::CODE_RGB:	channels = 3; break;
+	case SLIMCODE::CODE_RGBA:	channels = 4; break;
+	default:
+		return SLIMERROR::ERROR_BLOCK;
+	}
 
 	const uint32_t m_WIDTH	= (uint32_t)header._WIDTH;
 	const uint32_t m_HEIGHT = (uint32_t)header._HEIGHT;
 
-	img = (uint8_t*)SLIM_MALLOC(m_WIDTH * m_HEIGHT * 3);
+	if (w == 0 || h == 0 || (uint64_t)x + w > m_WIDTH || (uint64_t)y + h > m_HEIGHT) { return SLIMERROR::ERROR_ARG; }
+
+	const uint32_t blocksX	= (m_WIDTH + 15u) >> 4;
+	const uint32_t restart	= (header._FLAGS & FLAG_RESTART) ? header._RESTART : 0u;
+	const size_t   stride	= (size_t)w * channels;
+
+	SLIM_INDEX index;
+
+	const bool seek = (SLIM_READ_INDEX(infile, header, index) == SLIMERROR::ERROR_OK && restart > 0 && index._SEGMENT == restart);
 
-	uint8_t m_data		[1024]{0};	//Curret	block memory
-	uint8_t m_read		[1024]{0};	//Read		block memory
-	uint8_t m_size		[4]{0};		//Size 		blocks packed
+	uint8_t m_data		[1280]{0};	//Curret	block memory
+	uint8_t m_read		[1280]{0};	//Read		block memory
 
 	uint32_t qnt 		= 0;
+	uint32_t block		= 0;		//Next block in the stream
+
+	for (uint32_t blcY = y & ~15u; blcY < y + h && res == SLIMERROR::ERROR_OK; blcY += 16)
+	{
+		const uint32_t first	= (blcY >> 4) * blocksX + (x >> 4);
+		const uint32_t last		= (blcY >> 4) * blocksX + ((x + w - 1u) >> 4);
+
+		if (seek && block < first - first % restart) {
+			block = first - first % restart;
+
+			if (!infile.setPos(index._BASE + index._OFFSET[block / restart])) { res = SLIMERROR::ERROR_FILE; break; }
+		}
+
+		const uint32_t y0 = std::max(y, blcY) - blcY;
+		const uint32_t y1 = std::min(y + h, blcY + 16u) - blcY;
+
+		for (; block <= last; ++block)
+		{
+			if (restart > 0 && block % restart == 0) { memset(m_data, 0, sizeof(m_data)); }
+
+			res = SLIM_READ_BLOCK(infile, channels, m_data, m_read, qnt);
+
+			if (res != SLIMERROR::ERROR_OK) { break; }
+
+			if (block < first) { continue; }
+
+			const uint32_t blcX	= (block - (blcY >> 4) * blocksX) << 4;
+			const uint32_t x0	= std::max(x, blcX) - blcX;
+			const uint32_t x1	= std::min(x + w, blcX + 16u) - blcX;
+
+			uint8_t* dst = out + (size_t)(blcY + y0 - y) * stride + (size_t)(blcX + x0 - x) * channels;
+
+			SLIM_PUT_RECT(m_data, channels, qnt, std::min(16u, m_WIDTH - blcX), x0, y0, x1, y1, dst, stride);
+		}
+	}
+
+	Free_Index(index);
+
+	return res;
+}
+
+
+SLIMERROR Load_SLIM_Level(MiniStream &infile, SLIM_INFO &header, uint32_t level, uint8_t* &img){
+
+	//--------------------------------------------------------------//
+	//Decode one MIP level (0 - base image), header gets its size
+	//--------------------------------------------------------------//
+
+	if (!infile.isOpen()){return SLIMERROR::ERROR_FILE;}
+
+	SLIMERROR res = SLIM_READ_HEADER(infile, header);
+
+	if (res != SLIMERROR::ERROR_OK) { return res; }
+
+	uint32_t channels;
+
+	switch (header._CODE)
+	{
+	case SLIMCODE::CODE_RGB:	channels = 3; break;
+	case SLIMCODE::CODE_RGBA:	channels = 4; break;
+	default:
+		return SLIMERROR::ERROR_BLOCK;
+	}
+
+	if (level == 0) { return SLIM_READ_BLOCKS(infile, header, img, channels); }
+
+	if (level > header._MIPS) { return SLIMERROR::ERROR_ARG; }
+
+	const uint64_t base = infile.getPos();
+
+	uint32_t size		= 0;
+	uint32_t levels		= 0;
+	uint64_t offset		= 0;
+
+	res = SLIM_FIND_CHUNK(infile, base, header._FLAGS, SLIM_CHUNK_MIP, size);
+
+	if (res != SLIMERROR::ERROR_OK) { return (res == SLIMERROR::ERROR_NONE) ? SLIMERROR::ERROR_DATA : res; }
+
+	const uint64_t table = infile.getPos();
+
+	if (!infile.read(&levels, 4, 1)) { return SLIMERROR::ERROR_END; }
+
+	if (levels != header._MIPS || size != 4u + levels * 8u) { return SLIMERROR::ERROR_DATA; }
+
+	if (!infile.setPos(table + 4u + (level - 1u) * 8u) || !infile.read(&offset, 8, 1)) { return SLIMERROR::ERROR_END; }
+
+	if (offset >= table - base || !infile.setPos(base + offset)) { return SLIMERROR::ERROR_DATA; }
+
+	header._WIDTH	= (uint16_t)SLIM_MIP_SIZE(header._WIDTH, level);
+	header._HEIGHT	= (uint16_t)SLIM_MIP_SIZE(header._HEIGHT, level);
+	header._FLAGS	&= ~(FLAG_INDEX | FLAG_RESTART);
+	header._RESTART	= 0;
+
+	return SLIM_READ_BLOCKS(infile, header, img, channels);
+}
+
+
+SLIMERROR Load_SLIM_Map(MiniStream &infile, SLIM_INFO &header, uint8_t* &img){
+
+	if (!infile.isOpen()){return SLIMERROR::ERROR_FILE;}
+
+	SLIMERROR res = SLIM_READ_HEADER(infile, header);
+
+	if (res != SLIMERROR::ERROR_OK) { return res; }
+
+	header._CODE = SLIMCODE::CODE_MAP;
+
+	const uint32_t m_WIDTH = header._WIDTH;
+	const uint32_t m_HEIGHT = header._HEIGHT;
+
+	img = (uint8_t*)SLIM_MALLOC(m_WIDTH * m_HEIGHT);
+
+	uint8_t m_size		[5]{0};
+
+
+	uint32_t qnt_idx 	= 0;
 	uint16_t meta_code	= 0;
 
 	for (uint32_t blcY = 0; blcY < m_HEIGHT; blcY += 16)
 	{
 		for (uint32_t blcX = 0; blcX < m_WIDTH; blcX += 16)
 		{
-				
 			if (!infile.read(&meta_code, 1, 2)){ return SLIMERROR::ERROR_END; }
 
-			qnt = (meta_code & 0x07u) << 1;
+			qnt_idx  = (meta_code & 0x07u);
 			meta_code >>= 0x03u;
 
 			uint32_t t;
@@ -751,38 +2720,29 @@ SLIMERROR 	SLIM_READ_BLOCKS_3CHANNEL(MiniStream &infile, SLIM_INFO &header, uint
 			t = meta_code / 1296u;  uint16_t v0 = t;  meta_code -= t * 1296u;
 			t = meta_code /  216u;  uint16_t v1 = t;  meta_code -= t *  216u;
 			t = meta_code /   36u;  uint16_t v2 = t;  meta_code -= t *   36u;
-			t = meta_code /    6u;  				  meta_code -= t *    6u;
+			t = meta_code /    6u;  uint16_t v3 = t;  meta_code -= t *    6u;
 			uint16_t v4 = meta_code;
 
 			bool ch0_org	= (v0>0);
 			bool ch1_org	= (v1>0);
 			bool ch2_org	= (v2>0);
+			bool ch3_org	= (v3>0);
 			bool idx_org	= (v4>0);
 
-			uint8_t cm_size = ch0_org + ch1_org + ch2_org + idx_org;
+			uint8_t cm_size = ch0_org + ch1_org + ch2_org + ch3_org + idx_org;
 
 			if (!infile.read(m_size, 1, cm_size)){ return SLIMERROR::ERROR_END; }
 
-			uint8_t  pos 				= 0x0u;
-			const uint32_t cmps_ch0 	= ch0_org ? 0x1u + m_size[pos++] : 0x0u;
-			const uint32_t cmps_ch1 	= ch1_org ? 0x1u + m_size[pos++] : 0x0u;
-			const uint32_t cmps_ch2 	= ch2_org ? 0x1u + m_size[pos++] : 0x0u;
-			const uint32_t cmps_idx 	= idx_org ? 0x1u + m_size[pos++] : 0x0u;
-
-			const uint32_t st_ch1  		= cmps_ch0;
-			const uint32_t st_ch2  		= st_ch1 + cmps_ch1;
-			const uint32_t st_idx  		= st_ch2 + cmps_ch2;
-			const uint32_t st_size 		= st_idx + cmps_idx;
+			uint8_t  cm_pos 			= 0u;
+			const uint32_t cmps_ch0 	= ch0_org ? 1 + ((uint32_t)m_size[cm_pos++]) : 0u;
+			const uint32_t cmps_ch1 	= ch1_org ? 1 + ((uint32_t)m_size[cm_pos++]) : 0u;
+			const uint32_t cmps_ch2 	= ch2_org ? 1 + ((uint32_t)m_size[cm_pos++]) : 0u;
+			const uint32_t cmps_ch3 	= ch3_org ? 1 + ((uint32_t)m_size[cm_pos++]) : 0u;
+			const uint32_t cmps_idx 	= idx_org ? 1 + ((uint32_t)m_size[cm_pos++]) : 0u;
 
-			if (!infile.read(m_read, 1, st_size)){ return SLIMERROR::ERROR_END; }
-			
-			DECODE_REVOLVER(v0, m_read, m_data, cmps_ch0);
-			DECODE_REVOLVER(v1, m_read + st_ch1, m_data + 256, cmps_ch1);
-			DECODE_REVOLVER(v2, m_read + st_ch2, m_data + 512, cmps_ch2);
-			DECODE_REVOLVER(v4, m_read + st_idx, m_data + 768, cmps_idx);
+			const uint32_t st_size		= cmps_ch0 + cmps_ch1 + cmps_ch2 + cmps_ch3 + cmps_idx;
 
-			uint32_t idxclr		= 0;
-			uint32_t Cout		= 0;
+			if (!infile.seek(st_size,MiniStream::Cur)){ return SLIMERROR::ERROR_END; }
 
 			for (uint32_t y = 0; y < 16; ++y)
 			{
@@ -794,459 +2754,614 @@ SLIMERROR 	SLIM_READ_BLOCKS_3CHANNEL(MiniStream &infile, SLIM_INFO &header, uint
 
 					if (column >= m_WIDTH || row >= m_HEIGHT) { continue; }
 
-					uint32_t index = 3 * (row * m_WIDTH + column);
+					uint32_t index	= (row * m_WIDTH + column);
+					img[index]		= qnt_idx;
+
+				}
+			}
+		}
+	}
+
+
+	return SLIMERROR::ERROR_OK;
+}
+
+
+
+uint32_t SLIM_MINI_INDEX_MAX(uint16_t mode, const uint8_t* src, uint32_t size, uint32_t Cout, uint8_t* scratch){
+
+	//--------------------------------------------------------------//
+	//Largest of the first Cout entries of an index stream. Stored
+	//and RLE streams are scanned as they are, the bit codecs are
+	//decoded into scratch.
+	//--------------------------------------------------------------//
+
+	uint32_t top = 0;
+
+	if (mode == 1) {
+		for (uint32_t i = 0; i < std::min(size, Cout); ++i) { top = std::max<uint32_t>(top, src[i]); }
+		return top;
+	}
+
+	if (mode == 2) {
+		uint32_t idx	= 0;
+		uint32_t i		= 0;
+
+		while (i < size && idx < Cout) {
+			const int8_t cnt = int8_t(src[i++]);
+
+			if (cnt > 0) {
+				if (i >= size) { break; }
+				top = std::max<uint32_t>(top, src[i++]);
+				idx += uint32_t(cnt);
+			}
+			else {
+				const uint32_t n = std::min(std::min(uint32_t(-cnt), size - i), Cout - idx);
+				for (uint32_t k = 0; k < n; ++k) { top = std::max<uint32_t>(top, src[i + k]); }
+				i	+= uint32_t(-cnt);
+				idx	+= n;
+			}
+		}
+
+		return top;
+	}
+
+	memset(scratch, 0, 256);
+	DECODE_REVOLVER(mode, src, scratch, size);
+
+	for (uint32_t i = 0; i < Cout; ++i) { top = std::max<uint32_t>(top, scratch[i]); }
+
+	return top;
+}
+
+
+SLIMERROR Load_SLIM_Mini(MiniStream &infile, SLIM_INFO &header, uint8_t* &img){
+
+	//--------------------------------------------------------------//
+	//Thumbnail with one pixel per 16x16 block: the mean of the block
+	//palette, every entry counted once. Only the palette streams are
+	//decoded. The index stream is read for the palette size only
+	//when no palette stream gives it, and its payload is kept for
+	//blocks that reuse it. Quantized colors use the mean of the
+	//dither noise. header gets the thumbnail size.
+	//--------------------------------------------------------------//
+
+	if (!infile.isOpen()){return SLIMERROR::ERROR_FILE;}
+
+	SLIMERROR res = SLIM_READ_HEADER(infile, header);
+
+	if (res != SLIMERROR::ERROR_OK) { return res; }
+
+	uint32_t channels;
+
+	switch (header._CODE)
+	{
+	case SLIMCODE::CODE_RGB:	channels = 3; break;
+	case SLIMCODE::CODE_RGBA:	channels = 4; break;
+	default:
+		return SLIMERROR::ERROR_BLOCK;
+	}
+
+	const uint32_t m_WIDTH	= (uint32_t)header._WIDTH;
+	const uint32_t m_HEIGHT = (uint32_t)header._HEIGHT;
+	const uint32_t blocksX	= (m_WIDTH + 15u) >> 4;
+	const uint32_t blocksY	= (m_HEIGHT + 15u) >> 4;
+
+	img = (uint8_t*)SLIM_MALLOC((size_t)blocksX * blocksY * channels);
+
+	if (img == NULL) { return SLIMERROR::ERROR_MEM; }
+
+	uint8_t m_data		[1024]{0};	//Palette	block memory
+	uint8_t m_read		[1280]{0};	//Read		block memory
+	uint8_t m_keep		[256]{0};	//Payload of the last stored index stream
+	uint8_t m_scratch	[256]{0};	//Decoded	index stream
+
+	uint16_t keep_mode	= 0;		//Codec of m_keep, 0 - the zeroed start state
+	uint32_t keep_size	= 0;
+	uint32_t keep_cout	= 0;		//Pixel count of the block before, 0 - none
+	uint32_t CColor		= 1;
+
+	uint16_t v[5];
+	uint8_t	 m_size[5];
+	uint32_t cmps[5];
+
+	uint32_t qnt 		= 0;
+	uint32_t block		= 0;
+	uint8_t* px			= img;
+
+	for (uint32_t blcY = 0; blcY < m_HEIGHT; blcY += 16)
+	{
+		for (uint32_t blcX = 0; blcX < m_WIDTH; blcX += 16, ++block, px += channels)
+		{
+			if (header._RESTART > 0 && block % header._RESTART == 0) {
+				memset(m_data, 0, sizeof(m_data));
+				keep_mode	= 0;
+				keep_cout	= 0;
+			}
+
+			uint16_t meta_code = 0;
+
+			if (!infile.read(&meta_code, 1, 2)){ return SLIMERROR::ERROR_END; }
+
+			SLIM_META_UNPACK(meta_code, channels, v, qnt);
+
+			const uint8_t cm_size = (v[0]>0) + (v[1]>0) + (v[2]>0) + (v[3]>0) + (v[4]>0);
+
+			if (!infile.read(m_size, 1, cm_size)){ return SLIMERROR::ERROR_END; }
+
+			const uint32_t st_size	= SLIM_STREAM_SIZES(v, m_size, cmps);
+			const uint32_t st_idx	= st_size - cmps[4];
+
+			size_t available = 0;
+
+			const uint8_t* view		= infile.view(available);
+			const uint8_t* streams	= m_read;
+
+			if (view != NULL && available >= st_size) {
+				streams = view;
+				if (!infile.seek(st_size, MiniStream::Cur)){ return SLIMERROR::ERROR_END; }
+			}
+			else if (!infile.read(m_read, 1, st_size)){ return SLIMERROR::ERROR_END; }
+
+			//Stored and RLE palette streams decode to exactly the palette size
+			uint32_t st		= 0;
+			uint32_t exact	= 0;
+
+			for (uint32_t s = 0; s < 4; ++s) {
+				if (v[s] == 2 && exact == 0) {
+					uint8_t* dest = m_data + 256u * s;
+					if (RLE_DECODE_SAFE(streams + st, cmps[s], dest, exact, 256) != RLE_RESULT::RLE_OK) { exact = 0; }
+				}
+				else {
+					DECODE_REVOLVER(v[s], streams + st, m_data + 256u * s, cmps[s]);
+					if (v[s] == 1 && exact == 0) { exact = cmps[s]; }
+				}
+				st += cmps[s];
+			}
+
+			//--------------------------------------------------------------//
+			//Every palette entry is used, so otherwise the size is the
+			//largest index plus one. A reused index over the same pixel
+			//count keeps the size of the block before.
+			//--------------------------------------------------------------//
+
+			const uint32_t Cout = std::min(16u, m_WIDTH - blcX) * std::min(16u, m_HEIGHT - blcY);
+
+			if (v[4] > 0) {
+				keep_mode	= v[4];
+				keep_size	= cmps[4];
+				memcpy(m_keep, streams + st_idx, keep_size);
+			}
+
+			if (exact > 0) {
+				CColor = exact;
+			}
+			else if (v[4] > 0 || Cout != keep_cout) {
+				CColor = 1u + ((keep_mode > 0) ? SLIM_MINI_INDEX_MAX(keep_mode, m_keep, keep_size, Cout, m_scratch) : 0u);
+			}
+
+			keep_cout = Cout;
 
-					idxclr = m_data[768 + Cout];
+			uint64_t sum[3]		= {0, 0, 0};
+			uint64_t weighted[3]	= {0, 0, 0};
+			uint64_t alpha		= 0;
 
-					uint8_t chn0	= m_data[idxclr];
-					uint8_t chn1 	= m_data[idxclr + 256];
-					uint8_t chn2 	= m_data[idxclr + 512];
+			for (uint32_t e = 0; e < CColor; ++e)
+			{
+				uint8_t chn[4] = {m_data[e], m_data[e + 256], m_data[e + 512], 255};
 
-					if (qnt > 0) {
-						double pnl = perlin_noise_frame[Cout];
-						chn0 = perlin_pixel(chn0, qnt, pnl);
-						chn1 = perlin_pixel(chn1, qnt, pnl);
-						chn2 = perlin_pixel(chn2, qnt, pnl);
-					}
+				if (channels == 4) { chn[3] = m_data[e + 768]; }
 
-					img[index]		= chn0;
-					img[index + 1] 	= chn1;
-					img[index + 2] 	= chn2;
+				if (qnt > 0 && chn[3] > 0) {
+					for (uint32_t c = 0; c < channels; ++c) { chn[c] = perlin_pixel(chn[c], qnt, 0.5); }
+				}
 
-					++Cout;
+				alpha += chn[3];
 
+				for (uint32_t c = 0; c < 3; ++c)
+				{
+					sum[c]		+= chn[c];
+					weighted[c]	+= (uint64_t)chn[c] * chn[3];
 				}
 			}
+
+			//Colors are weighted by alpha, as in the MIP levels
+			for (uint32_t c = 0; c < 3; ++c) {
+				px[c] = (uint8_t)((alpha > 0) ? (weighted[c] + alpha / 2u) / alpha : (sum[c] + CColor / 2u) / CColor);
+			}
+
+			if (channels == 4) { px[3] = (uint8_t)((alpha + CColor / 2u) / CColor); }
 		}
 	}
 
+	header._WIDTH	= (uint16_t)blocksX;
+	header._HEIGHT	= (uint16_t)blocksY;
+
 	return SLIMERROR::ERROR_OK;
 }
 
 
+SLIMERROR Load_SLIM_Scaled(MiniStream &infile, SLIM_INFO &header, uint32_t scale, uint8_t* &img){
+
+	//--------------------------------------------------------------//
+	//Decode at 1/scale (1, 2, 4 or 8) by sampling the index map, the
+	//pixels match the full decode. header gets the scaled size.
+	//--------------------------------------------------------------//
+
+	if (!infile.isOpen()){return SLIMERROR::ERROR_FILE;}
+	if (scale != 1 && scale != 2 && scale != 4 && scale != 8){return SLIMERROR::ERROR_ARG;}
+
+	SLIMERROR res = SLIM_READ_HEADER(infile, header);
 
+	if (res != SLIMERROR::ERROR_OK) { return res; }
 
+	uint32_t channels;
 
-SLIMERROR SLIM_READ_BLOCKS_4CHANNEL(MiniStream &infile, SLIM_INFO &header, uint8_t* &img){
+	switch (header._CODE)
+	{
+	case SLIMCODE::CODE_RGB:	channels = 3; break;
+	case SLIMCODE::CODE_RGBA:	channels = 4; break;
+	default:
+		return SLIMERROR::ERROR_BLOCK;
+	}
 
 	const uint32_t m_WIDTH	= (uint32_t)header._WIDTH;
 	const uint32_t m_HEIGHT = (uint32_t)header._HEIGHT;
+	const uint32_t s_WIDTH	= (m_WIDTH + scale - 1u) / scale;
+	const uint32_t s_HEIGHT	= (m_HEIGHT + scale - 1u) / scale;
+	const size_t   stride	= (size_t)s_WIDTH * channels;
 
-	img = (uint8_t*)SLIM_MALLOC(m_WIDTH * m_HEIGHT * 4);
+	img = (uint8_t*)SLIM_MALLOC(stride * s_HEIGHT);
+
+	if (img == NULL) { return SLIMERROR::ERROR_MEM; }
 
 	uint8_t m_data		[1280]{0};	//Curret	block memory
 	uint8_t m_read		[1280]{0};	//Read		block memory
-	uint8_t m_size		[5]{0};		//Size 		blocks packed
 
-	uint32_t qnt		= 0;
-	uint16_t meta_code	= 0;
+	uint32_t qnt 		= 0;
+	uint32_t block		= 0;
 
 	for (uint32_t blcY = 0; blcY < m_HEIGHT; blcY += 16)
 	{
-		for (uint32_t blcX = 0; blcX < m_WIDTH; blcX += 16)
+		for (uint32_t blcX = 0; blcX < m_WIDTH; blcX += 16, ++block)
 		{
+			if (header._RESTART > 0 && block % header._RESTART == 0) { memset(m_data, 0, sizeof(m_data)); }
 
-			if (!infile.read(&meta_code, 1, 2)){ return SLIMERROR::ERROR_END; }
+			res = SLIM_READ_BLOCK(infile, channels, m_data, m_read, qnt);
 
-			qnt = (meta_code & 0x07u) << 1;
-			meta_code >>= 0x03u;
+			if (res != SLIMERROR::ERROR_OK) { return res; }
 
-			uint32_t t;
+			const uint32_t bw = std::min(16u, m_WIDTH - blcX);
+			const uint32_t bh = std::min(16u, m_HEIGHT - blcY);
 
-			t = meta_code / 1296u;  uint16_t v0 = t;  meta_code -= t * 1296u;
-			t = meta_code /  216u;  uint16_t v1 = t;  meta_code -= t *  216u;
-			t = meta_code /   36u;  uint16_t v2 = t;  meta_code -= t *   36u;
-			t = meta_code /    6u;  uint16_t v3 = t;  meta_code -= t *    6u;
-			uint16_t v4 = meta_code;
+			SLIM_PUT_RECT(m_data, channels, qnt, bw, 0, 0, bw, bh, img + (blcY / scale) * stride + (size_t)(blcX / scale) * channels, stride, scale);
+		}
+	}
 
-			bool ch0_org	= (v0>0);
-			bool ch1_org	= (v1>0);
-			bool ch2_org	= (v2>0);
-			bool ch3_org	= (v3>0);
-			bool idx_org	= (v4>0);
+	header._WIDTH	= (uint16_t)s_WIDTH;
+	header._HEIGHT	= (uint16_t)s_HEIGHT;
 
-			uint8_t cm_size = ch0_org + ch1_org + ch2_org + ch3_org + idx_org;
+	return SLIMERROR::ERROR_OK;
+}
 
-			if (!infile.read(m_size, 1, cm_size)){ return SLIMERROR::ERROR_END; }
 
-			uint8_t  cm_pos 			= 0x0u;
-			const uint32_t cmps_ch0 	= ch0_org ? 0x1u + ((uint32_t)m_size[cm_pos++]) : 0x0u;
-			const uint32_t cmps_ch1 	= ch1_org ? 0x1u + ((uint32_t)m_size[cm_pos++]) : 0x0u;
-			const uint32_t cmps_ch2 	= ch2_org ? 0x1u + ((uint32_t)m_size[cm_pos++]) : 0x0u;
-			const uint32_t cmps_ch3 	= ch3_org ? 0x1u + ((uint32_t)m_size[cm_pos++]) : 0x0u;
-			const uint32_t cmps_idx 	= idx_org ? 0x1u + ((uint32_t)m_size[cm_pos++]) : 0x0u;
+SLIM_INFO SLIM_LAYER_INFO(const SLIM_INFO &header, const SLIM_LAYER &layer){
 
-			const uint32_t st_ch1		= cmps_ch0;
-			const uint32_t st_ch2		= st_ch1 + cmps_ch1;
-			const uint32_t st_ch3		= st_ch2 + cmps_ch2;
-			const uint32_t st_idx		= st_ch3 + cmps_ch3;
-			const uint32_t st_size		= st_idx + cmps_idx;
+	SLIM_INFO tmp = header;
 
-			if (!infile.read(m_read, 1, st_size)){ return SLIMERROR::ERROR_END; }
+	tmp._WIDTH	= layer._WIDTH;
+	tmp._HEIGHT	= layer._HEIGHT;
+	tmp._CODE	= layer._CODE;
+	tmp._LEVEL	= layer._LEVEL;
+	tmp._FLAGS	&= (FLAG_INDEX | FLAG_RESTART);
+	tmp._MIPS	= 0;
+	tmp._LAYERS	= 0;
 
-			DECODE_REVOLVER(v0, m_read, m_data, cmps_ch0);
-			DECODE_REVOLVER(v1, m_read + st_ch1, m_data + 256, cmps_ch1);
-			DECODE_REVOLVER(v2, m_read + st_ch2, m_data + 512, cmps_ch2);
-			DECODE_REVOLVER(v3, m_read + st_ch3, m_data + 768, cmps_ch3);
-			DECODE_REVOLVER(v4, m_read + st_idx, m_data + 1024, cmps_idx);
+	return tmp;
+}
 
-			uint32_t idxclr		= 0;
-			uint32_t Cout		= 0;
 
-			for (uint32_t y = 0; y < 16; ++y)
-			{
-				for (uint32_t x = 0; x < 16; ++x)
-				{
+uint32_t SLIM_LAYER_SEGMENT(const SLIM_INFO &header, const SLIM_LAYER &layer){
 
-					uint32_t column		= blcX + x;
-					uint32_t row		= blcY + y;
+	//One index entry per restart interval, or per block row without restarts
+	return (header._FLAGS & FLAG_RESTART) ? header._RESTART : ((uint32_t)layer._WIDTH + 15u) >> 4;
+}
 
-					if (column >= m_WIDTH || row >= m_HEIGHT) { continue; }
 
-					uint32_t index	= 4 * (row * m_WIDTH + column);
+uint32_t SLIM_LAYER_ENTRIES(const SLIM_LAYER &layer, uint32_t segment){
 
-					idxclr	= m_data[1024 + Cout];
+	const uint32_t blocks = (((uint32_t)layer._WIDTH + 15u) >> 4) * (((uint32_t)layer._HEIGHT + 15u) >> 4);
 
-					uint8_t chn0	= m_data[idxclr];
-					uint8_t chn1 	= m_data[idxclr + 256];
-					uint8_t chn2 	= m_data[idxclr + 512];
-					uint8_t chn3 	= m_data[idxclr + 768];
+	return (blocks + segment - 1u) / segment;
+}
 
-					if (qnt > 0 && chn3 > 0) {
-						double pnl = perlin_noise_frame[Cout];
-						chn0 = perlin_pixel(chn0, qnt, pnl);
-						chn1 = perlin_pixel(chn1, qnt, pnl);
-						chn2 = perlin_pixel(chn2, qnt, pnl);
-						chn3 = perlin_pixel(chn3, qnt, pnl);
-					}
 
-					img[index]		= chn0;
-					img[index + 1] 	= chn1;
-					img[index + 2] 	= chn2;
-					img[index + 3] 	= chn3;
+SLIMERROR Save_SLIM_Layers(MiniStream &outfile, SLIM_INFO &header, SLIM_LAYER* layers, uint8_t** imgs, uint32_t count, unsigned threads){
 
-					++Cout;
-				}
-			}
-		}
-	}
+	//--------------------------------------------------------------//
+	//Header and layer directory, then the blocks of every layer one
+	//after another. The directory is rewritten once the layer
+	//offsets are known. Size and code of each layer come from
+	//layers, filter, flags and restarts from header.
+	//--------------------------------------------------------------//
 
+	if (!outfile.isOpen()){return SLIMERROR::ERROR_FILE;}
+	if (layers == NULL || imgs == NULL || count == 0){return SLIMERROR::ERROR_ARG;}
 
-	return SLIMERROR::ERROR_OK;
-}
+	if (header._VERS != uint32_t(SLIM_VER)) 									{ return SLIMERROR::ERROR_NOTSUP; }
+	if (header._FLAGS & ~(FLAG_INDEX | FLAG_RESTART | FLAG_LAYERS | FLAG_STATS)) { return SLIMERROR::ERROR_ARG; }
+	if ((header._FLAGS & FLAG_RESTART) && header._RESTART == 0) 				{ return SLIMERROR::ERROR_ARG; }
 
+	//The stats chunk describes a single image
+	header._FLAGS &= ~FLAG_STATS;
 
-SLIM_INFO Create_Info(uint16_t w, uint16_t h, uint8_t code, uint8_t filter, uint8_t level){
+	uint32_t groups = 0;
 
-	SLIM_INFO tmp;
-	tmp._VERS = SLIM_VER;
-	tmp._WIDTH = w;
-	tmp._HEIGHT = h;
-	tmp._CODE = code;
-	tmp._FILTER = filter;
-	tmp._LEVEL = level;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		SLIM_LAYER &layer = layers[i];
 
-	return tmp;
-}
+		if (imgs[i] == NULL) 													{ return SLIMERROR::ERROR_ARG; }
+		if (layer._WIDTH == 0 || layer._HEIGHT == 0) 							{ return SLIMERROR::ERROR_BLOCK; }
+		if (layer._CODE != SLIMCODE::CODE_RGB && layer._CODE != SLIMCODE::CODE_RGBA) { return SLIMERROR::ERROR_BLOCK; }
 
+		uint32_t j = 0;
 
-SLIMERROR Save_SLIM(MiniStream &outfile, SLIM_INFO &header, uint8_t* &img){
+		while (j < i && (layers[j]._WIDTH != layer._WIDTH || layers[j]._HEIGHT != layer._HEIGHT)) { ++j; }
 
-	if (!outfile.isOpen()){return SLIMERROR::ERROR_FILE;}
-	if (img == NULL){return SLIMERROR::ERROR_ARG;}
+		if (j < i) {
+			layer._GROUP = layers[j]._GROUP;
+		}
+		else {
+			if (groups > 0xFFFFu) { return SLIMERROR::ERROR_ARG; }
+			layer._GROUP = (uint16_t)groups++;
+		}
 
-	if (header._VERS != uint32_t(SLIM_VER)) 									{ return SLIMERROR::ERROR_NOTSUP; }
-	if (header._WIDTH == 0 || header._HEIGHT == 0) 								{ return SLIMERROR::ERROR_BLOCK; }
+		layer._OFFSET = 0;
+	}
 
-	if (!outfile.write(MINI_SLIM_HEADER, 1,sizeof(MINI_SLIM_HEADER))){ return SLIMERROR::ERROR_BLOCK; }
-	if (!outfile.write(reinterpret_cast<char*>(&header), 1, sizeof(SLIM_INFO))) { return SLIMERROR::ERROR_BLOCK; }
+	header._WIDTH	= layers[0]._WIDTH;
+	header._HEIGHT	= layers[0]._HEIGHT;
+	header._CODE	= layers[0]._CODE;
+	header._LEVEL	= layers[0]._LEVEL;
+	header._FLAGS	|= FLAG_LAYERS;
+	header._MIPS	= 0;
+	header._LAYERS	= count;
 
-	SLIMERROR res =SLIMERROR::ERROR_OK;
+	//Index layout per size group, offsets per layer
+	const bool indexed = (header._FLAGS & FLAG_INDEX) != 0;
 
-	switch (header._CODE)
-	{
-	case SLIMCODE::CODE_RGB:
-		res = SLIM_WRITE_BLOCKS_3CHANNEL(outfile, header, img);
-		break;
-	case SLIMCODE::CODE_RGBA:
-		res = SLIM_WRITE_BLOCKS_4CHANNEL(outfile, header, img);
-		break;
-	default:
-		return SLIMERROR::ERROR_BLOCK;
-	}
+	uint32_t* layout	= NULL;
+	uint64_t* table		= NULL;
+	uint64_t  entries	= 0;
 
-	return res;
-}
+	if (indexed) {
+		layout = (uint32_t*)SLIM_MALLOC((size_t)groups * 8u);
 
+		if (layout == NULL) { return SLIMERROR::ERROR_MEM; }
 
-SLIMERROR Info_SLIM(MiniStream &infile, SLIM_INFO_FULL &info){
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const uint32_t segment = SLIM_LAYER_SEGMENT(header, layers[i]);
 
-	if (!infile.isOpen()){return SLIMERROR::ERROR_FILE;}
+			layout[layers[i]._GROUP * 2u]		= segment;
+			layout[layers[i]._GROUP * 2u + 1u]	= SLIM_LAYER_ENTRIES(layers[i], segment);
 
-	char m_buf[sizeof(MINI_SLIM_HEADER)] = {0};
-	SLIM_INFO header;
-	
-	if (!infile.read(m_buf, 1, sizeof(MINI_SLIM_HEADER))) 						{ return SLIMERROR::ERROR_BLOCK; }
+			entries += layout[layers[i]._GROUP * 2u + 1u];
+		}
 
-	if (strncmp(m_buf, MINI_SLIM_HEADER, sizeof(MINI_SLIM_HEADER))) 			{ return SLIMERROR::ERROR_NOTSUP; }
+		if (4u + (uint64_t)groups * 8u + entries * 8u > 0xFFFFFFFFu) { SLIM_FREE(layout); return SLIMERROR::ERROR_ARG; }
 
-	if (!infile.read(reinterpret_cast<char*>(&header), 1, sizeof(SLIM_INFO))) 	{ return SLIMERROR::ERROR_BLOCK; }
+		table = (uint64_t*)SLIM_MALLOC((size_t)entries * sizeof(uint64_t));
 
-	if (header._VERS != uint32_t(SLIM_VER)) 									{ return SLIMERROR::ERROR_NOTSUP; }
-	if (header._WIDTH == 0 || header._HEIGHT == 0) 								{ return SLIMERROR::ERROR_BLOCK; }
+		if (table == NULL) { SLIM_FREE(layout); return SLIMERROR::ERROR_MEM; }
+	}
 
-	info._VERS 					= header._VERS;
-	info._WIDTH 				= header._WIDTH;
-	info._HEIGHT 				= header._HEIGHT;
-	info._CODE 					= header._CODE;	
-	info._FILTER 				= header._FILTER;
-	info._LEVEL					= header._LEVEL;
+	SLIMERROR res = SLIM_WRITE_HEADER(outfile, header);
 
-	info._BLOCK_256_ALL 		= 0;
-	info._BLOCK_256_EXIST		= 0;
-	info._BLOCK_256_EMPTY		= 0;
-	info._BLOCK_COLOR_TABLE_MAX = 0;
-	info._BLOCK_COLOR_TABLE_MIN = 0xFFFFFFFFu;
-	info._BLOCK_COLOR_TABLE_AVG = 0;
+	const uint64_t directory = outfile.getPos();
 
-	info._BLOCK_Q_MAX		= 0;
-	info._BLOCK_Q_MIN		= 0xFFFFFFFFu;
-	info._BLOCK_Q_AVG		= 0;
-	
-	info._ALL_C					= 0;
-	info._REUSE_C				= 0;
-	info._ORIGINAL_C			= 0;
-	info._RICE_C				= 0;
-	info._RLE_C					= 0;
-	info._SLDD_C				= 0;
-	info._MASKARED_C			= 0;
-	
-	const uint32_t m_WIDTH	= (uint32_t)header._WIDTH;
-	const uint32_t m_HEIGHT = (uint32_t)header._HEIGHT;
+	if (res == SLIMERROR::ERROR_OK && !outfile.write(layers, sizeof(SLIM_LAYER), count)) { res = SLIMERROR::ERROR_BLOCK; }
 
-	uint8_t m_data		[1280]{0};	//Curret	block memory
-	uint8_t m_read		[1280]{0};	//Read		block memory
-	uint8_t m_size		[5]{0};		//Size 		blocks packed
+	const uint64_t base = outfile.getPos();
 
-	uint16_t comp_pack[5]{0,0,0,0,0};
-	uint32_t qnt 		= 0;
+	std::unique_ptr<MiniPool> pool;
 
-	uint16_t meta_code	= 0;
+	if (threads != 1) { pool.reset(new MiniPool(threads)); }
 
-	for (uint32_t blcY = 0; blcY < m_HEIGHT; blcY += 16)
-	{
-		for (uint32_t blcX = 0; blcX < m_WIDTH; blcX += 16)
-		{
+	uint64_t* entry = table;
 
-			if (!infile.read(&meta_code, 1, 2)){ return SLIMERROR::ERROR_END; }
+	for (uint32_t i = 0; i < count && res == SLIMERROR::ERROR_OK; ++i)
+	{
+		SLIM_INFO layer		= SLIM_LAYER_INFO(header, layers[i]);
+		SLIM_INDEX index	= {0, 0, 0, entry};
 
-			qnt = (meta_code & 0x07u)<< 1;
-			meta_code >>= 0x03u;
+		if (indexed) {
+			index._SEGMENT	= layout[layers[i]._GROUP * 2u];
+			index._COUNT	= layout[layers[i]._GROUP * 2u + 1u];
+			entry			+= index._COUNT;
+		}
 
-			uint32_t t;
+		layers[i]._OFFSET = outfile.getPos() - base;
 
-			t = meta_code / 1296;  comp_pack[0] = t;  meta_code -= t * 1296;
-			t = meta_code /  216;  comp_pack[1] = t;  meta_code -= t *  216;
-			t = meta_code /   36;  comp_pack[2] = t;  meta_code -= t *   36;
-			t = meta_code /    6;  comp_pack[3] = t;  meta_code -= t *    6;
-			comp_pack[4] = meta_code;
-
-			bool ch0_org	= (comp_pack[0]>0);
-			bool ch1_org	= (comp_pack[1]>0);
-			bool ch2_org	= (comp_pack[2]>0);
-			bool ch3_org	= (comp_pack[3]>0);
-			bool idx_org	= (comp_pack[4]>0);
-
-			for(uint8_t i=0; i<5; ++i){
-				info._REUSE_C		+= (comp_pack[i]==0);
-				info._ORIGINAL_C	+= (comp_pack[i]==1);
-				info._RLE_C			+= (comp_pack[i]==2);
-				info._RICE_C		+= (comp_pack[i]==3);
-				info._SLDD_C		+= (comp_pack[i]==4);
-				info._MASKARED_C	+= (comp_pack[i]==5);
-			}
+		res = SLIM_ENCODE_BLOCKS(outfile, layer, imgs[i], layer._CODE == SLIMCODE::CODE_RGBA ? 4u : 3u, indexed ? &index : NULL, NULL, pool.get());
+	}
 
-			if(ch0_org || ch1_org || ch2_org || ch3_org){
-				if(info._BLOCK_Q_MAX<qnt){info._BLOCK_Q_MAX=qnt;}
-				if(info._BLOCK_Q_MIN>qnt){info._BLOCK_Q_MIN=qnt;}
-			}
+	if (res == SLIMERROR::ERROR_OK && indexed) {
+		const uint32_t size = 4u + groups * 8u + (uint32_t)entries * 8u;
 
-			uint8_t cm_size = ch0_org + ch1_org + ch2_org + ch3_org + idx_org;
+		SLIM_CHUNK chunk = {SLIM_CHUNK_INDEX, size};
 
-			info._BLOCK_256_ALL++;
-			info._BLOCK_256_EXIST += (cm_size>0);
-			info._BLOCK_256_EMPTY += (cm_size==0);
-			info._BLOCK_Q_AVG += qnt;
+		if (!outfile.write(&groups, 4, 1) || !outfile.write(layout, 8, groups) || !outfile.write(table, 8, (size_t)entries) || !outfile.write(&chunk, 1, sizeof(SLIM_CHUNK))) {
+			res = SLIMERROR::ERROR_BLOCK;
+		}
+	}
 
-			if (!infile.read(m_size, 1, cm_size)){ return SLIMERROR::ERROR_END; }
+	if (res == SLIMERROR::ERROR_OK) {
+		const uint64_t end = outfile.getPos();
 
-			uint8_t  cm_pos 			= 0x0u;
-			const uint32_t cmps_ch0 	= ch0_org ? 0x1u + ((uint32_t)m_size[cm_pos++]) : 0x0u;
-			const uint32_t cmps_ch1 	= ch1_org ? 0x1u + ((uint32_t)m_size[cm_pos++]) : 0x0u;
-			const uint32_t cmps_ch2 	= ch2_org ? 0x1u + ((uint32_t)m_size[cm_pos++]) : 0x0u;
-			const uint32_t cmps_ch3 	= ch3_org ? 0x1u + ((uint32_t)m_size[cm_pos++]) : 0x0u;
-			const uint32_t cmps_idx 	= idx_org ? 0x1u + ((uint32_t)m_size[cm_pos++]) : 0x0u;
-
-			const uint32_t st_ch1		= cmps_ch0;
-			const uint32_t st_ch2		= st_ch1 + cmps_ch1;
-			const uint32_t st_ch3		= st_ch2 + cmps_ch2;
-			const uint32_t st_idx		= st_ch3 + cmps_ch3;
-			const uint32_t st_size		= st_idx + cmps_idx;
-
-			if (!infile.read(m_read, 1, st_size)){ return SLIMERROR::ERROR_END; }
-
-			DECODE_REVOLVER(comp_pack[0], m_read, m_data, cmps_ch0);
-			DECODE_REVOLVER(comp_pack[1], m_read + st_ch1, m_data + 256, cmps_ch1);
-			DECODE_REVOLVER(comp_pack[2], m_read + st_ch2, m_data + 512, cmps_ch2);
-			DECODE_REVOLVER(comp_pack[3], m_read + st_ch3, m_data + 768, cmps_ch3);
-			DECODE_REVOLVER(comp_pack[4], m_read + st_idx, m_data + 1024, cmps_idx);
-
-			uint32_t lc_blk_max = 0;
-			uint32_t lc_blk_min = 0xFFFFFFFFu;
-			if(idx_org){
-				for(uint32_t idx = 0; idx<256; ++idx){
-					uint32_t idxclr = m_data[1024 + idx]+1;
-					if(info._BLOCK_COLOR_TABLE_MIN>idxclr){info._BLOCK_COLOR_TABLE_MIN=idxclr;}
-					if(info._BLOCK_COLOR_TABLE_MAX<idxclr){info._BLOCK_COLOR_TABLE_MAX=idxclr;}			
-					if(lc_blk_min>idxclr){lc_blk_min=idxclr;}
-					if(lc_blk_max<idxclr){lc_blk_max=idxclr;}
-				}
-				info._BLOCK_COLOR_TABLE_AVG+=lc_blk_max;
-			}
-			
-		}
+		if (!outfile.setPos(directory) || !outfile.write(layers, sizeof(SLIM_LAYER), count) || !outfile.setPos(end)) { res = SLIMERROR::ERROR_FILE; }
 	}
-	info._ALL_C = info._REUSE_C + info._ORIGINAL_C + info._RLE_C + info._RICE_C + info._SLDD_C + info._MASKARED_C;
-	info._BLOCK_Q_AVG /= info._BLOCK_256_ALL;
-	info._BLOCK_COLOR_TABLE_AVG /= info._BLOCK_256_EXIST;
 
-	return  SLIMERROR::ERROR_OK;
+	if (layout != NULL)	{ SLIM_FREE(layout); }
+	if (table != NULL)	{ SLIM_FREE(table); }
+
+	return res;
 }
 
 
-SLIMERROR Load_SLIM(MiniStream &infile, SLIM_INFO &header, uint8_t* &img){
+SLIMERROR Open_SLIM_Layers(MiniStream &infile, SLIM_LAYERS &dir){
+
+	//--------------------------------------------------------------//
+	//Read the layer directory and the index of every layer, a file
+	//without layers opens as a single layer
+	//--------------------------------------------------------------//
+
+	dir._COUNT	= 0;
+	dir._BASE	= 0;
+	dir._LAYER	= NULL;
+	dir._INDEX	= NULL;
+	dir._TABLE	= NULL;
 
 	if (!infile.isOpen()){return SLIMERROR::ERROR_FILE;}
 
-	char m_buf[sizeof(MINI_SLIM_HEADER)] = {0};
-	
-	if (!infile.read(m_buf, 1, sizeof(MINI_SLIM_HEADER))) { return SLIMERROR::ERROR_BLOCK; }
+	SLIMERROR res = SLIM_READ_HEADER(infile, dir._HEADER);
 
-	if (strncmp(m_buf, MINI_SLIM_HEADER, sizeof(MINI_SLIM_HEADER))) { return SLIMERROR::ERROR_NOTSUP; }
+	if (res != SLIMERROR::ERROR_OK) { return res; }
 
-	if (!infile.read(reinterpret_cast<char*>(&header), 1, sizeof(SLIM_INFO))) 	{ return SLIMERROR::ERROR_BLOCK; }
+	SLIM_INFO &header	= dir._HEADER;
+	const uint32_t count	= (header._FLAGS & FLAG_LAYERS) ? header._LAYERS : 1u;
+	const uint64_t base		= infile.getPos();
+	const uint64_t end		= infile.size();
 
+	if ((uint64_t)count * sizeof(SLIM_LAYER) > base) { return SLIMERROR::ERROR_DATA; }
 
-	if (header._VERS != uint32_t(SLIM_VER)) 									{ return SLIMERROR::ERROR_NOTSUP; }
-	if (header._WIDTH == 0 || header._HEIGHT == 0) 								{ return SLIMERROR::ERROR_BLOCK; }
+	dir._LAYER = (SLIM_LAYER*)SLIM_MALLOC((size_t)count * sizeof(SLIM_LAYER));
 
-	SLIMERROR res = SLIMERROR::ERROR_OK;
+	if (dir._LAYER == NULL) { return SLIMERROR::ERROR_MEM; }
 
-	switch (header._CODE)
-	{
-	case SLIMCODE::CODE_RGB:
-		res = SLIM_READ_BLOCKS_3CHANNEL(infile, header, img);
-		break;
-	case SLIMCODE::CODE_RGBA:
-		res = SLIM_READ_BLOCKS_4CHANNEL(infile, header, img);
-		break;
-	default:
-		return SLIMERROR::ERROR_BLOCK;
+	dir._COUNT	= count;
+	dir._BASE	= base;
+
+	if (header._FLAGS & FLAG_LAYERS) {
+		if (!infile.setPos(base - (uint64_t)count * sizeof(SLIM_LAYER)) || !infile.read(dir._LAYER, sizeof(SLIM_LAYER), count)) { Free_Layers(dir); return SLIMERROR::ERROR_END; }
+	}
+	else {
+		dir._LAYER[0]	= {header._WIDTH, header._HEIGHT, header._CODE, header._LEVEL, 0, 0};
 	}
 
-	return res;
-}
+	uint32_t groups = 0;
 
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const SLIM_LAYER &layer = dir._LAYER[i];
 
+		if (layer._WIDTH == 0 || layer._HEIGHT == 0 || layer._OFFSET >= end - base || layer._GROUP > groups ||
+			(layer._CODE != SLIMCODE::CODE_RGB && layer._CODE != SLIMCODE::CODE_RGBA)) { Free_Layers(dir); return SLIMERROR::ERROR_DATA; }
 
-SLIMERROR Load_SLIM_Map(MiniStream &infile, SLIM_INFO &header, uint8_t* &img){
+		if (layer._GROUP == groups) { ++groups; }
+	}
 
-	if (!infile.isOpen()){return SLIMERROR::ERROR_FILE;}
+	if (!(header._FLAGS & FLAG_INDEX)) { return infile.setPos(base) ? SLIMERROR::ERROR_OK : SLIMERROR::ERROR_FILE; }
 
-	char m_buf[sizeof(MINI_SLIM_HEADER)] = {0};
-	
-	if (!infile.read(m_buf, 1, sizeof(MINI_SLIM_HEADER))) { return SLIMERROR::ERROR_BLOCK; }
+	dir._INDEX = (SLIM_INDEX*)SLIM_MALLOC((size_t)count * sizeof(SLIM_INDEX));
 
-	if (strncmp(m_buf, MINI_SLIM_HEADER, sizeof(MINI_SLIM_HEADER))) { return SLIMERROR::ERROR_NOTSUP; }
+	if (dir._INDEX == NULL) { Free_Layers(dir); return SLIMERROR::ERROR_MEM; }
 
-	if (!infile.read(reinterpret_cast<char*>(&header), 1, sizeof(SLIM_INFO))) 	{ return SLIMERROR::ERROR_BLOCK; }
+	if (!(header._FLAGS & FLAG_LAYERS)) {
+		if (!infile.setPos(base)) { Free_Layers(dir); return SLIMERROR::ERROR_FILE; }
 
-	if (header._VERS != uint32_t(SLIM_VER)) 									{ return SLIMERROR::ERROR_NOTSUP; }
-	if (header._WIDTH == 0 || header._HEIGHT == 0) 								{ return SLIMERROR::ERROR_BLOCK; }
+		res = SLIM_READ_INDEX(infile, header, dir._INDEX[0]);
 
-	header._CODE = SLIMCODE::CODE_MAP;
+		dir._TABLE = dir._INDEX[0]._OFFSET;
 
-	const uint32_t m_WIDTH = header._WIDTH;
-	const uint32_t m_HEIGHT = header._HEIGHT;
+		if (res != SLIMERROR::ERROR_OK) { Free_Layers(dir); }
 
-	img = (uint8_t*)SLIM_MALLOC(m_WIDTH * m_HEIGHT);
+		return res;
+	}
 
-	uint8_t m_size		[5]{0};
+	uint32_t size		= 0;
+	uint32_t stored		= 0;
 
+	res = SLIM_FIND_CHUNK(infile, base, header._FLAGS, SLIM_CHUNK_INDEX, size);
 
-	uint32_t qnt_idx 	= 0;
-	uint16_t meta_code	= 0;
+	if (res != SLIMERROR::ERROR_OK) { Free_Layers(dir); return (res == SLIMERROR::ERROR_NONE) ? SLIMERROR::ERROR_DATA : res; }
 
-	for (uint32_t blcY = 0; blcY < m_HEIGHT; blcY += 16)
+	std::vector<uint32_t> layout((size_t)groups * 2u);
+
+	if (!infile.read(&stored, 4, 1) || stored != groups || !infile.read(layout.data(), 8, groups)) { Free_Layers(dir); return SLIMERROR::ERROR_DATA; }
+
+	uint64_t entries = 0;
+
+	for (uint32_t i = 0; i < count; ++i)
 	{
-		for (uint32_t blcX = 0; blcX < m_WIDTH; blcX += 16)
-		{
-			if (!infile.read(&meta_code, 1, 2)){ return SLIMERROR::ERROR_END; }
+		const SLIM_LAYER &layer	= dir._LAYER[i];
+		const uint32_t segment	= layout[layer._GROUP * 2u];
 
-			qnt_idx  = (meta_code & 0x07u);
-			meta_code >>= 0x03u;
+		if (segment == 0 || layout[layer._GROUP * 2u + 1u] != SLIM_LAYER_ENTRIES(layer, segment)) { Free_Layers(dir); return SLIMERROR::ERROR_DATA; }
 
-			uint32_t t;
+		entries += layout[layer._GROUP * 2u + 1u];
+	}
 
-			t = meta_code / 1296u;  uint16_t v0 = t;  meta_code -= t * 1296u;
-			t = meta_code /  216u;  uint16_t v1 = t;  meta_code -= t *  216u;
-			t = meta_code /   36u;  uint16_t v2 = t;  meta_code -= t *   36u;
-			t = meta_code /    6u;  uint16_t v3 = t;  meta_code -= t *    6u;
-			uint16_t v4 = meta_code;
+	if (size != 4u + groups * 8u + entries * 8u) { Free_Layers(dir); return SLIMERROR::ERROR_DATA; }
 
-			bool ch0_org	= (v0>0);
-			bool ch1_org	= (v1>0);
-			bool ch2_org	= (v2>0);
-			bool ch3_org	= (v3>0);
-			bool idx_org	= (v4>0);
+	dir._TABLE = (uint64_t*)SLIM_MALLOC((size_t)entries * sizeof(uint64_t));
 
-			uint8_t cm_size = ch0_org + ch1_org + ch2_org + ch3_org + idx_org;
+	if (dir._TABLE == NULL) { Free_Layers(dir); return SLIMERROR::ERROR_MEM; }
 
-			if (!infile.read(m_size, 1, cm_size)){ return SLIMERROR::ERROR_END; }
+	if (!infile.read(dir._TABLE, 8, (size_t)entries)) { Free_Layers(dir); return SLIMERROR::ERROR_END; }
 
-			uint8_t  cm_pos 			= 0u;
-			const uint32_t cmps_ch0 	= ch0_org ? 1 + ((uint32_t)m_size[cm_pos++]) : 0u;
-			const uint32_t cmps_ch1 	= ch1_org ? 1 + ((uint32_t)m_size[cm_pos++]) : 0u;
-			const uint32_t cmps_ch2 	= ch2_org ? 1 + ((uint32_t)m_size[cm_pos++]) : 0u;
-			const uint32_t cmps_ch3 	= ch3_org ? 1 + ((uint32_t)m_size[cm_pos++]) : 0u;
-			const uint32_t cmps_idx 	= idx_org ? 1 + ((uint32_t)m_size[cm_pos++]) : 0u;
+	uint64_t* entry = dir._TABLE;
 
-			const uint32_t st_size		= cmps_ch0 + cmps_ch1 + cmps_ch2 + cmps_ch3 + cmps_idx;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		SLIM_INDEX &index = dir._INDEX[i];
 
-			if (!infile.seek(st_size,MiniStream::Cur)){ return SLIMERROR::ERROR_END; }
+		index._SEGMENT	= layout[dir._LAYER[i]._GROUP * 2u];
+		index._COUNT	= layout[dir._LAYER[i]._GROUP * 2u + 1u];
+		index._BASE		= base + dir._LAYER[i]._OFFSET;
+		index._OFFSET	= entry;
 
-			for (uint32_t y = 0; y < 16; ++y)
-			{
-				for (uint32_t x = 0; x < 16; ++x)
-				{
+		entry += index._COUNT;
+	}
 
-					uint32_t column		= blcX + x;
-					uint32_t row		= blcY + y;
+	return infile.setPos(base) ? SLIMERROR::ERROR_OK : SLIMERROR::ERROR_FILE;
+}
 
-					if (column >= m_WIDTH || row >= m_HEIGHT) { continue; }
 
-					uint32_t index	= (row * m_WIDTH + column);
-					img[index]		= qnt_idx;
+SLIMERROR Load_SLIM_Layer(MiniStream &infile, SLIM_LAYERS &dir, uint32_t layer, uint8_t* &img, unsigned threads){
 
-				}
-			}
-		}
+	if (!infile.isOpen()){return SLIMERROR::ERROR_FILE;}
+	if (layer >= dir._COUNT){return SLIMERROR::ERROR_ARG;}
+
+	SLIM_INFO header = SLIM_LAYER_INFO(dir._HEADER, dir._LAYER[layer]);
+
+	const uint32_t channels = (header._CODE == SLIMCODE::CODE_RGBA) ? 4u : 3u;
+
+	if (!infile.setPos(dir._BASE + dir._LAYER[layer]._OFFSET)) { return SLIMERROR::ERROR_FILE; }
+
+	//Restart segments of the layer can be decoded in parallel
+	if (threads != 1 && dir._INDEX != NULL && (header._FLAGS & FLAG_RESTART) && dir._INDEX[layer]._SEGMENT == header._RESTART) {
+		return SLIM_READ_SEGMENTS(infile, header, dir._INDEX[layer], channels, img, threads);
 	}
 
+	return SLIM_READ_BLOCKS(infile, header, img, channels);
+}
+
+
+SLIMERROR Free_Layers(SLIM_LAYERS &dir){
+
+	if (dir._LAYER != NULL) { SLIM_FREE(dir._LAYER); }
+	if (dir._INDEX != NULL) { SLIM_FREE(dir._INDEX); }
+	if (dir._TABLE != NULL) { SLIM_FREE(dir._TABLE); }
+
+	dir._LAYER	= NULL;
+	dir._INDEX	= NULL;
+	dir._TABLE	= NULL;
+	dir._COUNT	= 0;
 
 	return SLIMERROR::ERROR_OK;
 }
 
 
-
 #endif // miniSLIM_H
\ No newline at end of file
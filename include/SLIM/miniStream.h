@@ -2,8 +2,23 @@
 #define MINI_STREAM_H
 
 #include <fstream>
+#include <algorithm>
 #include <cstdint>
 #include <cstddef>
+#include <cstring>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 class MiniStream {
 protected:
@@ -36,11 +51,18 @@ public:
     virtual size_t getPos() const = 0;
     virtual bool setPos(size_t t) = 0;
     virtual size_t size() const = 0;
+
+    // Streams that keep their contents in memory return the bytes from
+    // the current position on without copying them, others return nullptr.
+    virtual const uint8_t* view(size_t& available) const {
+        available = 0;
+        return nullptr;
+    }
     
     uint8_t getMode() { return _mode; }
 };
 
-class IStream : public MiniStream {
+class IStream final : public MiniStream {
 private:
     mutable std::fstream file_;
 
@@ -152,4 +174,845 @@ public:
     }
 };
 
+// Stream over memory: either a read-only view of caller owned bytes or a
+// growable buffer owned by the stream. The owned buffer survives close(),
+// so an encoded image can be taken with data()/release() afterwards.
+class MemoryStream final : public MiniStream {
+private:
+    const uint8_t* extern_ = nullptr;
+    std::vector<uint8_t> buffer_;
+    size_t size_ = 0;
+    size_t pos_ = 0;
+    bool open_ = false;
+
+    const uint8_t* base() const {
+        return extern_ != nullptr ? extern_ : buffer_.data();
+    }
+
+public:
+    // Read-only view, data must outlive the stream
+    MemoryStream(const uint8_t* data, size_t size) : extern_(data), size_(size) {
+        _mode = MiniStream::Read;
+        open_ = (data != nullptr || size == 0);
+    }
+
+    // Owned buffer, reserve is a hint for the expected size
+    explicit MemoryStream(uint8_t mode = MiniStream::Write, size_t reserve = 0) {
+        buffer_.reserve(reserve);
+        open(nullptr, mode);
+    }
+
+    ~MemoryStream() override = default;
+
+    // Reopens the stream, the name is ignored. Write and CRW clear the
+    // owned buffer, the other modes keep it. A view opens only for Read.
+    bool open(const char* filename, uint8_t mode) override {
+        (void)filename;
+        _mode = mode;
+        open_ = false;
+        pos_ = 0;
+
+        switch (mode) {
+        case MiniStream::Write:
+        case MiniStream::CRW:
+            if (extern_ != nullptr) return false;
+            buffer_.clear();
+            size_ = 0;
+            break;
+        case MiniStream::Read:
+        case MiniStream::ORW:
+            if (extern_ != nullptr && mode != MiniStream::Read) return false;
+            break;
+        case MiniStream::Append:
+            if (extern_ != nullptr) return false;
+            pos_ = size_;
+            break;
+        default:
+            return false;
+        }
+
+        open_ = true;
+        return true;
+    }
+
+    bool close() override {
+        if (!open_) return false;
+        open_ = false;
+        return true;
+    }
+
+    bool isOpen() const override {
+        return open_;
+    }
+
+    bool reserve(size_t bytes) {
+        if (extern_ != nullptr) return false;
+        buffer_.reserve(bytes);
+        return true;
+    }
+
+    const uint8_t* data() const {
+        return base();
+    }
+
+    // Hands the owned buffer to the caller and leaves the stream empty
+    std::vector<uint8_t> release() {
+        buffer_.resize(size_);
+        std::vector<uint8_t> out;
+        out.swap(buffer_);
+        size_ = 0;
+        pos_ = 0;
+        return out;
+    }
+
+    bool write(const void* buffer, size_t size, size_t count) override {
+        if (!open_ || extern_ != nullptr || _mode == MiniStream::Read) return false;
+
+        const size_t bytes = size * count;
+        if (_mode == MiniStream::Append) pos_ = size_;
+
+        if (pos_ + bytes > buffer_.size()) {
+            if (pos_ + bytes > buffer_.capacity()) {
+                buffer_.reserve(std::max(pos_ + bytes, buffer_.capacity() * 2));
+            }
+            buffer_.resize(pos_ + bytes);
+        }
+
+        if (bytes > 0) memcpy(buffer_.data() + pos_, buffer, bytes);
+        pos_ += bytes;
+        if (pos_ > size_) size_ = pos_;
+        return true;
+    }
+
+    bool read(void* buffer, size_t size, size_t count) override {
+        if (!open_) return false;
+
+        const size_t bytes = size * count;
+        if (pos_ > size_ || bytes > size_ - pos_) {
+            pos_ = size_;
+            return false;
+        }
+
+        if (bytes > 0) memcpy(buffer, base() + pos_, bytes);
+        pos_ += bytes;
+        return true;
+    }
+
+    bool seek(size_t offset, uint8_t origin) override {
+        if (!open_) return false;
+
+        size_t pos;
+        switch (origin) {
+        case MiniStream::Set:
+            pos = offset;
+            break;
+        case MiniStream::Cur:
+            pos = pos_ + offset;
+            break;
+        case MiniStream::End:
+            pos = size_ + offset;
+            break;
+        default:
+            return false;
+        }
+
+        return setPos(pos);
+    }
+
+    size_t getPos() const override {
+        return pos_;
+    }
+
+    bool setPos(size_t pos) override {
+        if (!open_) return false;
+        if (_mode == MiniStream::Read && pos > size_) return false;
+        pos_ = pos;
+        return true;
+    }
+
+    size_t size() const override {
+        return size_;
+    }
+
+    const uint8_t* view(size_t& available) const override {
+        if (!open_ || pos_ > size_ || base() == nullptr) {
+            available = 0;
+            return nullptr;
+        }
+
+        available = size_ - pos_;
+        return base() + pos_;
+    }
+};
+
+// Decorator that batches the small reads and writes of the block coders
+// into buffer sized calls on the wrapped stream. The buffer holds either
+// pending writes or read-ahead data, never both. Streams with view()
+// are passed through so in-place decoding keeps working.
+class BufferedStream final : public MiniStream {
+private:
+    MiniStream& inner_;
+    std::vector<uint8_t> buffer_;
+    size_t start_ = 0;      // stream position of buffer_[0]
+    size_t length_ = 0;     // valid bytes in the buffer
+    size_t pos_ = 0;
+    bool dirty_ = false;    // the buffer holds writes not yet passed on
+    mutable bool noview_ = false;   // the wrapped stream has no view(), skip the probe
+
+    bool drop() {
+        bool ok = true;
+        if (dirty_ && length_ > 0) {
+            ok = inner_.setPos(start_) && inner_.write(buffer_.data(), 1, length_);
+        }
+        dirty_ = false;
+        length_ = 0;
+        return ok;
+    }
+
+public:
+    static const size_t DefaultCapacity = 1u << 20;
+
+    explicit BufferedStream(MiniStream& inner, size_t capacity = DefaultCapacity) : inner_(inner) {
+        buffer_.resize(capacity < 4096 ? 4096 : capacity);
+        _mode = inner.getMode();
+        pos_ = inner.isOpen() ? inner.getPos() : 0;
+    }
+
+    ~BufferedStream() override {
+        flush();
+    }
+
+    BufferedStream(const BufferedStream&) = delete;
+    BufferedStream& operator=(const BufferedStream&) = delete;
+
+    // Passes pending writes to the wrapped stream
+    bool flush() {
+        if (!dirty_) return true;
+        return drop();
+    }
+
+    bool open(const char* filename, uint8_t mode) override {
+        drop();
+        _mode = mode;
+        pos_ = 0;
+        noview_ = false;
+        if (!inner_.open(filename, mode)) return false;
+        pos_ = inner_.getPos();
+        return true;
+    }
+
+    // Flushes and closes the wrapped stream
+    bool close() override {
+        const bool ok = drop();
+        return inner_.close() && ok;
+    }
+
+    bool isOpen() const override {
+        return inner_.isOpen();
+    }
+
+    bool write(const void* buffer, size_t size, size_t count) override {
+        if (!inner_.isOpen()) return false;
+
+        const size_t bytes = size * count;
+        if (_mode == MiniStream::Append) pos_ = this->size();
+        noview_ = false;
+
+        // Continue the pending run only if the write follows it
+        if (!dirty_ || pos_ != start_ + length_) {
+            if (!drop()) return false;
+            start_ = pos_;
+            dirty_ = true;
+        }
+
+        if (length_ + bytes > buffer_.size()) {
+            if (!drop()) return false;
+            start_ = pos_;
+            dirty_ = true;
+        }
+
+        if (bytes >= buffer_.size()) {
+            dirty_ = false;
+            if (!inner_.setPos(pos_) || !inner_.write(buffer, 1, bytes)) return false;
+            pos_ += bytes;
+            return true;
+        }
+
+        memcpy(buffer_.data() + length_, buffer, bytes);
+        length_ += bytes;
+        pos_ += bytes;
+        return true;
+    }
+
+    bool read(void* buffer, size_t size, size_t count) override {
+        if (!inner_.isOpen()) return false;
+        if (dirty_ && !drop()) return false;
+
+        uint8_t* out = static_cast<uint8_t*>(buffer);
+        size_t bytes = size * count;
+
+        while (bytes > 0) {
+            if (pos_ >= start_ && pos_ < start_ + length_) {
+                const size_t part = std::min(bytes, start_ + length_ - pos_);
+                memcpy(out, buffer_.data() + (pos_ - start_), part);
+                out += part;
+                pos_ += part;
+                bytes -= part;
+                continue;
+            }
+
+            length_ = 0;
+
+            // Large reads skip the buffer
+            if (bytes >= buffer_.size()) {
+                if (!inner_.setPos(pos_) || !inner_.read(out, 1, bytes)) return false;
+                pos_ += bytes;
+                return true;
+            }
+
+            const size_t total = inner_.size();
+            if (pos_ >= total) return false;
+
+            const size_t fill = std::min(buffer_.size(), total - pos_);
+            if (!inner_.setPos(pos_) || !inner_.read(buffer_.data(), 1, fill)) return false;
+
+            start_ = pos_;
+            length_ = fill;
+        }
+
+        return true;
+    }
+
+    bool seek(size_t offset, uint8_t origin) override {
+        if (!inner_.isOpen()) return false;
+
+        size_t pos;
+        switch (origin) {
+        case MiniStream::Set:
+            pos = offset;
+            break;
+        case MiniStream::Cur:
+            pos = pos_ + offset;
+            break;
+        case MiniStream::End:
+            pos = size() + offset;
+            break;
+        default:
+            return false;
+        }
+
+        return setPos(pos);
+    }
+
+    size_t getPos() const override {
+        return pos_;
+    }
+
+    bool setPos(size_t pos) override {
+        if (!inner_.isOpen()) return false;
+        if (_mode == MiniStream::Read && pos > inner_.size()) return false;
+        pos_ = pos;
+        return true;
+    }
+
+    size_t size() const override {
+        const size_t total = inner_.size();
+        return (dirty_ && start_ + length_ > total) ? start_ + length_ : total;
+    }
+
+    // The block readers ask once per block, so a wrapped stream that
+    // answered nullptr while open is not repositioned for it again
+    const uint8_t* view(size_t& available) const override {
+        available = 0;
+        if (noview_ || dirty_ || !inner_.setPos(pos_)) return nullptr;
+        const uint8_t* ptr = inner_.view(available);
+        noview_ = (ptr == nullptr && inner_.isOpen());
+        return ptr;
+    }
+};
+
+#if !defined(_WIN32)
+
+// File stream over mmap. Reads are plain memory copies and view() hands
+// out the mapping, so block payloads can be decoded in place. Writes go
+// to a shared mapping that grows with ftruncate; reserve() preallocates
+// it and close() trims the file to the bytes written.
+class MMapStream final : public MiniStream {
+private:
+    int fd_ = -1;
+    uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+    size_t pos_ = 0;
+
+    bool map(size_t capacity) {
+        if (data_ != nullptr) {
+            munmap(data_, capacity_);
+            data_ = nullptr;
+        }
+
+        capacity_ = capacity;
+        if (capacity_ == 0) return true;
+
+        const bool writable = (_mode != MiniStream::Read);
+        void* ptr = mmap(nullptr, capacity_, writable ? PROT_READ | PROT_WRITE : PROT_READ, writable ? MAP_SHARED : MAP_PRIVATE, fd_, 0);
+
+        if (ptr == MAP_FAILED) {
+            capacity_ = 0;
+            return false;
+        }
+
+        data_ = static_cast<uint8_t*>(ptr);
+        return true;
+    }
+
+    bool grow(size_t needed) {
+        if (needed <= capacity_) return true;
+
+        size_t capacity = capacity_ < 65536 ? 65536 : capacity_;
+        while (capacity < needed) capacity *= 2;
+
+        return reserve(capacity);
+    }
+
+public:
+    MMapStream(const char* filename, uint8_t mode) {
+        open(filename, mode);
+    }
+
+    MMapStream() = default;
+
+    ~MMapStream() override {
+        close();
+    }
+
+    MMapStream(const MMapStream&) = delete;
+    MMapStream& operator=(const MMapStream&) = delete;
+
+    bool open(const char* filename, uint8_t mode) override {
+        close();
+        _mode = mode;
+
+        int flags = 0;
+
+        switch (mode) {
+        case MiniStream::Write:
+        case MiniStream::CRW:
+            flags = O_RDWR | O_CREAT | O_TRUNC;
+            break;
+        case MiniStream::Read:
+            flags = O_RDONLY;
+            break;
+        case MiniStream::Append:
+            flags = O_RDWR | O_CREAT;
+            break;
+        case MiniStream::ORW:
+            flags = O_RDWR;
+            break;
+        default:
+            return false;
+        }
+
+        fd_ = ::open(filename, flags, 0644);
+        if (fd_ < 0) return false;
+
+        struct stat st;
+        if (fstat(fd_, &st) != 0 || !map((size_t)st.st_size)) {
+            ::close(fd_);
+            fd_ = -1;
+            return false;
+        }
+
+        size_ = (size_t)st.st_size;
+        pos_ = (mode == MiniStream::Append) ? size_ : 0;
+        return true;
+    }
+
+    bool close() override {
+        if (fd_ < 0) return false;
+
+        const size_t capacity = capacity_;
+        map(0);
+
+        bool ok = true;
+        if (_mode != MiniStream::Read && capacity != size_) {
+            ok = (ftruncate(fd_, (off_t)size_) == 0);
+        }
+
+        ok = (::close(fd_) == 0) && ok;
+        fd_ = -1;
+        size_ = 0;
+        pos_ = 0;
+        return ok;
+    }
+
+    bool isOpen() const override {
+        return fd_ >= 0;
+    }
+
+    // Preallocates the file for writes of up to bytes in total.
+    bool reserve(size_t bytes) {
+        if (fd_ < 0 || _mode == MiniStream::Read) return false;
+        if (bytes <= capacity_) return true;
+        if (ftruncate(fd_, (off_t)bytes) != 0) return false;
+        return map(bytes);
+    }
+
+    bool write(const void* buffer, size_t size, size_t count) override {
+        if (fd_ < 0 || _mode == MiniStream::Read) return false;
+
+        const size_t bytes = size * count;
+        if (_mode == MiniStream::Append) pos_ = size_;
+        if (!grow(pos_ + bytes)) return false;
+
+        if (bytes > 0) memcpy(data_ + pos_, buffer, bytes);
+        pos_ += bytes;
+        if (pos_ > size_) size_ = pos_;
+        return true;
+    }
+
+    bool read(void* buffer, size_t size, size_t count) override {
+        if (fd_ < 0) return false;
+
+        const size_t bytes = size * count;
+        if (pos_ > size_ || bytes > size_ - pos_) {
+            pos_ = size_;
+            return false;
+        }
+
+        if (bytes > 0) memcpy(buffer, data_ + pos_, bytes);
+        pos_ += bytes;
+        return true;
+    }
+
+    bool seek(size_t offset, uint8_t origin) override {
+        if (fd_ < 0) return false;
+
+        size_t pos;
+        switch (origin) {
+        case MiniStream::Set:
+            pos = offset;
+            break;
+        case MiniStream::Cur:
+            pos = pos_ + offset;
+            break;
+        case MiniStream::End:
+            pos = size_ + offset;
+            break;
+        default:
+            return false;
+        }
+
+        return setPos(pos);
+    }
+
+    size_t getPos() const override {
+        return pos_;
+    }
+
+    bool setPos(size_t pos) override {
+        if (fd_ < 0) return false;
+        if (_mode == MiniStream::Read && pos > size_) return false;
+        pos_ = pos;
+        return true;
+    }
+
+    size_t size() const override {
+        return size_;
+    }
+
+    const uint8_t* view(size_t& available) const override {
+        if (data_ == nullptr || pos_ > size_) {
+            available = 0;
+            return nullptr;
+        }
+
+        available = size_ - pos_;
+        return data_ + pos_;
+    }
+};
+
+// Read-only file stream that reads ahead on a background thread. A ring
+// of count buffers of chunk bytes each is filled with pread while the
+// decoder consumes the front one, so I/O latency overlaps decoding.
+// Seeking outside the buffered range restarts the read-ahead there.
+class PrefetchStream final : public MiniStream {
+public:
+    struct Stats {
+        uint64_t chunks = 0;        // buffers handed to the reader
+        uint64_t stalls = 0;        // times the reader waited for I/O
+        uint64_t stallMicros = 0;   // total time spent waiting
+    };
+
+    static const size_t DefaultChunk = 1u << 20;
+    static const size_t DefaultCount = 4;
+
+private:
+    struct Chunk {
+        std::vector<uint8_t> data;
+        size_t start = 0;
+        size_t length = 0;
+    };
+
+    int fd_ = -1;
+    size_t size_ = 0;
+    size_t pos_ = 0;
+    size_t chunkSize_ = DefaultChunk;
+    size_t chunkCount_ = DefaultCount;
+
+    Chunk current_;                 // owned by the reader, no lock needed
+
+    std::thread worker_;
+    std::mutex lock_;
+    std::condition_variable filled_;
+    std::condition_variable freed_;
+    std::deque<Chunk> ready_;
+    std::vector<std::vector<uint8_t>> free_;
+    size_t head_ = 0;               // start of the next chunk to arrive
+    size_t next_ = 0;               // next offset the worker reads
+    uint64_t generation_ = 0;       // bumped on every restart
+    bool stop_ = false;
+    bool failed_ = false;
+    Stats stats_;
+
+    void loop() {
+        std::unique_lock<std::mutex> guard(lock_);
+
+        for (;;) {
+            freed_.wait(guard, [&] { return stop_ || (!free_.empty() && next_ < size_ && !failed_); });
+            if (stop_) return;
+
+            Chunk chunk;
+            chunk.data.swap(free_.back());
+            free_.pop_back();
+            chunk.start = next_;
+            chunk.length = std::min(chunkSize_, size_ - next_);
+            next_ += chunk.length;
+
+            const uint64_t generation = generation_;
+            guard.unlock();
+
+            size_t done = 0;
+            while (done < chunk.length) {
+                const ssize_t got = pread(fd_, chunk.data.data() + done, chunk.length - done, (off_t)(chunk.start + done));
+                if (got <= 0) break;
+                done += (size_t)got;
+            }
+
+            guard.lock();
+
+            if (generation != generation_) {
+                free_.push_back(std::move(chunk.data));
+                continue;
+            }
+
+            if (done < chunk.length) failed_ = true;
+            else ready_.push_back(std::move(chunk));
+
+            filled_.notify_one();
+        }
+    }
+
+    void start() {
+        free_.clear();
+        for (size_t i = 0; i < chunkCount_; ++i) {
+            free_.emplace_back(chunkSize_);
+        }
+        current_.data.resize(chunkSize_);
+        worker_ = std::thread(&PrefetchStream::loop, this);
+    }
+
+    // Moves pos_ into current_, waiting for the worker when needed
+    bool fetch() {
+        std::unique_lock<std::mutex> guard(lock_);
+
+        if (!current_.data.empty()) free_.push_back(std::move(current_.data));
+        current_ = Chunk();
+
+        for (;;) {
+            while (!ready_.empty() && ready_.front().start + ready_.front().length <= pos_) {
+                head_ = ready_.front().start + ready_.front().length;
+                free_.push_back(std::move(ready_.front().data));
+                ready_.pop_front();
+            }
+            freed_.notify_one();
+
+            if (!ready_.empty() && ready_.front().start <= pos_) {
+                head_ = ready_.front().start + ready_.front().length;
+                current_ = std::move(ready_.front());
+                ready_.pop_front();
+                ++stats_.chunks;
+                return true;
+            }
+
+            // Behind the read-ahead or too far in front of it: restart at pos_
+            if (pos_ < head_ || pos_ - head_ >= chunkSize_ * chunkCount_) {
+                ++generation_;
+                for (Chunk& c : ready_) free_.push_back(std::move(c.data));
+                ready_.clear();
+                head_ = pos_;
+                next_ = pos_;
+                failed_ = false;
+                freed_.notify_one();
+            }
+
+            if (failed_) return false;
+
+            const auto wait = std::chrono::steady_clock::now();
+            ++stats_.stalls;
+            filled_.wait(guard, [&] { return stop_ || failed_ || !ready_.empty(); });
+            stats_.stallMicros += (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - wait).count();
+
+            if (stop_) return false;
+        }
+    }
+
+public:
+    PrefetchStream(const char* filename, size_t chunk = DefaultChunk, size_t count = DefaultCount) : chunkSize_(chunk), chunkCount_(count) {
+        open(filename, MiniStream::Read);
+    }
+
+    PrefetchStream() = default;
+
+    ~PrefetchStream() override {
+        close();
+    }
+
+    PrefetchStream(const PrefetchStream&) = delete;
+    PrefetchStream& operator=(const PrefetchStream&) = delete;
+
+    // Only MiniStream::Read is supported
+    bool open(const char* filename, uint8_t mode) override {
+        close();
+        _mode = mode;
+        if (mode != MiniStream::Read) return false;
+
+        if (chunkSize_ < 4096) chunkSize_ = 4096;
+        if (chunkCount_ < 2) chunkCount_ = 2;
+
+        fd_ = ::open(filename, O_RDONLY);
+        if (fd_ < 0) return false;
+
+        struct stat st;
+        if (fstat(fd_, &st) != 0) {
+            ::close(fd_);
+            fd_ = -1;
+            return false;
+        }
+
+#if defined(POSIX_FADV_SEQUENTIAL)
+        posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+        size_ = (size_t)st.st_size;
+        pos_ = 0;
+        head_ = 0;
+        next_ = 0;
+        generation_ = 0;
+        stop_ = false;
+        failed_ = false;
+        stats_ = Stats();
+        start();
+        return true;
+    }
+
+    bool close() override {
+        if (fd_ < 0) return false;
+
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            stop_ = true;
+        }
+        freed_.notify_all();
+        filled_.notify_all();
+        if (worker_.joinable()) worker_.join();
+
+        ready_.clear();
+        free_.clear();
+        current_ = Chunk();
+
+        const bool ok = (::close(fd_) == 0);
+        fd_ = -1;
+        size_ = 0;
+        pos_ = 0;
+        return ok;
+    }
+
+    bool isOpen() const override {
+        return fd_ >= 0;
+    }
+
+    bool write(const void*, size_t, size_t) override {
+        return false;
+    }
+
+    bool read(void* buffer, size_t size, size_t count) override {
+        if (fd_ < 0) return false;
+
+        uint8_t* out = static_cast<uint8_t*>(buffer);
+        size_t bytes = size * count;
+
+        if (pos_ > size_ || bytes > size_ - pos_) {
+            pos_ = size_;
+            return false;
+        }
+
+        while (bytes > 0) {
+            if (pos_ < current_.start || pos_ >= current_.start + current_.length) {
+                if (!fetch()) return false;
+            }
+
+            const size_t part = std::min(bytes, current_.start + current_.length - pos_);
+            memcpy(out, current_.data.data() + (pos_ - current_.start), part);
+            out += part;
+            pos_ += part;
+            bytes -= part;
+        }
+
+        return true;
+    }
+
+    bool seek(size_t offset, uint8_t origin) override {
+        if (fd_ < 0) return false;
+
+        size_t pos;
+        switch (origin) {
+        case MiniStream::Set:
+            pos = offset;
+            break;
+        case MiniStream::Cur:
+            pos = pos_ + offset;
+            break;
+        case MiniStream::End:
+            pos = size_ + offset;
+            break;
+        default:
+            return false;
+        }
+
+        return setPos(pos);
+    }
+
+    size_t getPos() const override {
+        return pos_;
+    }
+
+    bool setPos(size_t pos) override {
+        if (fd_ < 0 || pos > size_) return false;
+        pos_ = pos;
+        return true;
+    }
+
+    size_t size() const override {
+        return size_;
+    }
+
+    Stats stats() {
+        std::lock_guard<std::mutex> guard(lock_);
+        return stats_;
+    }
+};
+
+#endif // !_WIN32
+
 #endif // MINI_STREAM_H
\ No newline at end of file
@@ -1,11 +1,13 @@
 
 
-const char* PROGRAM_VERSION = "1.2.0.0";
+const char* PROGRAM_VERSION = "1.3.0.0";
 const char* PROGRAM_AUTHOR = "Sleptsov Vladimir";
 const char* PROGRAM_DESCRIPTION = "miniSLIM";
 const char* BUILD_DATE = __DATE__;
 const char* BUILD_TIME = __TIME__;
 
+unsigned SLIM_THREADS = 0;    //SLIM encoder and decoder threads, 0 = all cores
+
 #include <iostream>
 #include <string>
 #include <string>
@@ -44,12 +46,12 @@ bool load_image(const std::string& input, unsigned char* &data, int &w, int &h,
             return loadotherformat(input.c_str(), data, w, h, channels);
         case ImageFormat::fSLIM:
             {
-                IStream infile(input.c_str(), MiniStream::Mode::Read);
+                MMapStream infile(input.c_str(), MiniStream::Mode::Read);
 
                 if(infile.isOpen()) {
                     SLIM_INFO header;
 
-                    Load_SLIM(infile, header, data);
+                    Load_SLIM_Parallel(infile, header, data, SLIM_THREADS);
 
                     w           = header._WIDTH;
                     h           = header._HEIGHT;
@@ -79,8 +81,13 @@ bool load_image(const std::string& input, unsigned char* &data, int &w, int &h,
     std::cout << "  toslim [options] <image_path_a> <image_path_b>\n";
     std::cout << "\nOptions:\n";
     std::cout << "  -i          Get information about an image\n";
+    std::cout << "  -f          With -i, decode every block of a SLIM without stats for its palette sizes\n";
     std::cout << "  -c          Convert from format file to other format\n";
     std::cout << "  -q          Image quality level for JPEG and SLIM (0..255)\n";
+    std::cout << "  -r          Restart the SLIM reuse chain every N blocks (0 = every block row)\n";
+    std::cout << "  -p          Store N MIP levels in SLIM (0 = full chain down to 1x1)\n";
+    std::cout << "  -e          SLIM encoder effort (0 = fastest .. 7 = smallest)\n";
+    std::cout << "  -t          Threads for SLIM encoding and decoding (0 = all cores)\n";
     std::cout << "  -a          Comparison of images using PSNR/SSIM/PSQNR\n";
     std::cout << "  -w          Exporting a map from SLIM\n";
     std::cout << "  -h          Show this help message\n";
@@ -89,10 +96,16 @@ bool load_image(const std::string& input, unsigned char* &data, int &w, int &h,
     std::cout << "  toslim -c image.png image.SLIM                 Convert image.png to image.SLIM\n";
     std::cout << "  toslim -c image.SLIM image.png                 Convert image.SLIM to image.png\n";
     std::cout << "  toslim -c -q 128 image.png image.SLIM          Convert image.png to image.SLIM quality 50%\n";
+    std::cout << "  toslim -c -r 0 image.png image.SLIM            Convert image.png to image.SLIM with a restart every block row\n";
+    std::cout << "  toslim -c -t 4 image.SLIM image.png            Convert image.SLIM to image.png using 4 threads\n";
+    std::cout << "  toslim -c -p 0 image.png image.SLIM            Convert image.png to image.SLIM with a full MIP chain\n";
+    std::cout << "  toslim -c -e 0 image.png image.SLIM            Convert image.png to image.SLIM as fast as possible\n";
+    std::cout << "  toslim -i -f image.SLIM                        Full information about image.SLIM, palette sizes included\n";
     std::cout << "  toslim -a image.png image.SLIM                 Comparing image.png with image.SLIM\n";
     std::cout << "  toslim -w image.SLIM map.png                   Exporting a map from image.SLIM to map.png\n";
     std::cout << "\nDefault:\n";
     std::cout << "  Quality: 255 (MAX)\n";
+    std::cout << "  Effort: " << SLIM_EFFORT_DEFAULT << "\n";
     }
 #else
 #include "support/image_viewer.h"
@@ -106,8 +119,13 @@ bool load_image(const std::string& input, unsigned char* &data, int &w, int &h,
     std::cout << "  toslim [options] <image_path_a> <image_path_b>\n";
     std::cout << "\nOptions:\n";
     std::cout << "  -i          Get information about an image\n";
+    std::cout << "  -f          With -i, decode every block of a SLIM without stats for its palette sizes\n";
     std::cout << "  -c          Convert from format file to other format\n";
     std::cout << "  -q          Image quality level for JPEG and SLIM (0..255)\n";
+    std::cout << "  -r          Restart the SLIM reuse chain every N blocks (0 = every block row)\n";
+    std::cout << "  -p          Store N MIP levels in SLIM (0 = full chain down to 1x1)\n";
+    std::cout << "  -e          SLIM encoder effort (0 = fastest .. 7 = smallest)\n";
+    std::cout << "  -t          Threads for SLIM encoding and decoding (0 = all cores)\n";
     std::cout << "  -v          Display image (default behavior)\n";
     std::cout << "  -m          Display map image (only SLIM is supported)\n";
     std::cout << "  -a          Comparison of images using PSNR/SSIM/PSQNR\n";
@@ -121,10 +139,16 @@ bool load_image(const std::string& input, unsigned char* &data, int &w, int &h,
     std::cout << "  toslim -c image.png image.SLIM                 Convert image.png to image.SLIM\n";
     std::cout << "  toslim -c image.SLIM image.png                 Convert image.SLIM to image.png\n";
     std::cout << "  toslim -c -q 128 image.png image.SLIM          Convert image.png to image.SLIM quality 50%\n";
+    std::cout << "  toslim -c -r 0 image.png image.SLIM            Convert image.png to image.SLIM with a restart every block row\n";
+    std::cout << "  toslim -c -t 4 image.SLIM image.png            Convert image.SLIM to image.png using 4 threads\n";
+    std::cout << "  toslim -c -p 0 image.png image.SLIM            Convert image.png to image.SLIM with a full MIP chain\n";
+    std::cout << "  toslim -c -e 0 image.png image.SLIM            Convert image.png to image.SLIM as fast as possible\n";
+    std::cout << "  toslim -i -f image.SLIM                        Full information about image.SLIM, palette sizes included\n";
     std::cout << "  toslim -a image.png image.SLIM                 Comparing image.png with image.SLIM\n";
     std::cout << "  toslim -w image.SLIM map.png                   Exporting a map from image.SLIM to map.png\n";
     std::cout << "\nDefault:\n";
     std::cout << "  Quality: 255 (MAX)\n";
+    std::cout << "  Effort: " << SLIM_EFFORT_DEFAULT << "\n";
     }
 
     void DemoIMG(std::string file){
@@ -240,7 +264,7 @@ double Percent(uint32_t value, uint32_t total)
     return double(value) * 100.0 /double(total);
 }
 
-void InfoIMG(std::string imagePath){
+void InfoIMG(std::string imagePath, bool full){
 
     ImageFormat fmt = detect_format(imagePath);
 
@@ -263,8 +287,11 @@ void InfoIMG(std::string imagePath){
                 
                 if(infile.isOpen()){
                     
+                    //Without the stats chunk the palette sizes need every index decoded, only -f pays for that
                     SLIM_INFO_FULL header;
-                    Info_SLIM(infile,header);    
+                    if(full){ Info_SLIM(infile,header); }
+                    else{ Info_SLIM_Fast(infile,header); }
+                    const bool colors = full || (header._FLAGS & FLAG_STATS) != 0;
 
                     std::cout << "----[ INFORMATION ]----\n";
 
@@ -276,6 +303,10 @@ void InfoIMG(std::string imagePath){
                     uint8_t build = header._VERS & 0xFF;
 
                     std::cout<<"VERSION: "<<(int)major <<"."<<(int)minor<<"."<<(int)patch<<"."<<(int)build<< "\n";
+                    std::cout<<"INDEX: "<<((header._FLAGS & FLAG_INDEX) ? "YES" : "NO")<< "\n";
+                    std::cout<<"STATS: "<<((header._FLAGS & FLAG_STATS) ? "YES" : "NO")<< "\n";
+                    std::cout<<"MIP LEVELS: "<<header._MIPS<< "\n";
+                    std::cout<<"LAYERS: "<<((header._FLAGS & FLAG_LAYERS) ? header._LAYERS : 1u)<< "\n";
                     std::cout<<"WIDTH: "<<header._WIDTH<< "\n";
                     std::cout<<"HEIGHT: "<<header._HEIGHT<< "\n";
                     std::cout<<"CODE: ";
@@ -306,9 +337,14 @@ void InfoIMG(std::string imagePath){
                     const auto totalpix = header._BLOCK_256_ALL;
 
                     std::cout << "\n----[ BLOCKS " << totalpix << " ]----\n";
-                    std::cout << "COLOR MIN: "<< header._BLOCK_COLOR_TABLE_MIN<< "\n";
-                    std::cout << "COLOR MAX: "<< header._BLOCK_COLOR_TABLE_MAX<< "\n";
-                    std::cout << "COLOR AVG: "<< header._BLOCK_COLOR_TABLE_AVG<< "\n";
+                    if(colors){
+                        std::cout << "COLOR MIN: "<< header._BLOCK_COLOR_TABLE_MIN<< "\n";
+                        std::cout << "COLOR MAX: "<< header._BLOCK_COLOR_TABLE_MAX<< "\n";
+                        std::cout << "COLOR AVG: "<< header._BLOCK_COLOR_TABLE_AVG<< "\n";
+                    }
+                    else{
+                        std::cout << "COLOR: unavailable, the file has no stats chunk (use -f)\n";
+                    }
                      std::cout << "\n----[ BLOCKS " << totalpix << " ]----\n";
                     std::cout << "DELTA MIN: "<< header._BLOCK_Q_MIN<< "\n";
                     std::cout << "DELTA MAX: "<< header._BLOCK_Q_MAX<< "\n";
@@ -337,7 +373,7 @@ void InfoIMG(std::string imagePath){
 
 
 
-bool save_image(const std::string& output, unsigned char* data, int w, int h,  SLIMCODE chan, uint8_t quality) {
+bool save_image(const std::string& output, unsigned char* data, int w, int h,  SLIMCODE chan, uint8_t quality, uint32_t restart = 0, uint32_t mips = 0, uint8_t effort = SLIM_EFFORT_DEFAULT) {
 
 
     
@@ -355,7 +391,8 @@ bool save_image(const std::string& output, unsigned char* data, int w, int h,  S
             return stbi_write_tga(output.c_str(), w, h, channels, data);
         case ImageFormat::fSLIM:
             {
-                IStream infile(output.c_str(),MiniStream::Mode::Write);
+                IStream file(output.c_str(),MiniStream::Mode::Write);
+                BufferedStream infile(file);
                 
                 if(infile.isOpen()){
                     uint8_t     code    = chan;
@@ -363,8 +400,15 @@ bool save_image(const std::string& output, unsigned char* data, int w, int h,  S
                     uint16_t    width   = (uint16_t)w;
                     uint16_t    height  = (uint16_t)h;
 
-                    SLIM_INFO header = Create_Info(width, height, code, FILTER_COLORDIV, quality);
-                    Save_SLIM(infile,header,img);             
+                    SLIM_INFO header = Create_Info(width, height, code, FILTER_COLORDIV, quality, FLAG_INDEX | FLAG_STATS, restart, mips, effort);
+                    SLIM_INFO_FULL info;
+                    Save_SLIM_Parallel(infile,header,img,SLIM_THREADS,&info);            
+
+                    if(header._FLAGS & FLAG_RESTART){
+                        const int64_t total = (int64_t)infile.getPos();
+                        std::cout << "RESTART: every " << header._RESTART << " blocks\n";
+                        std::cout << "RESTART COST: " << info._RESTART_COST << " bytes (" << (total > 0 ? double(info._RESTART_COST) * 100.0 / double(total) : 0.0) << "%)\n";
+                    }
 
                     infile.close();
                 }
@@ -433,7 +477,7 @@ void AnalizeIMG(std::vector<std::string> files){
 
 
 
-void ConvertIMG(std::string fileA,std::string fileB, uint8_t quality){
+void ConvertIMG(std::string fileA,std::string fileB, uint8_t quality, uint32_t restart, uint32_t mips, uint8_t effort){
 
     unsigned char* data = NULL;
     int w = 0;
@@ -442,7 +486,7 @@ void ConvertIMG(std::string fileA,std::string fileB, uint8_t quality){
 
 
     if(load_image(fileA, data, w, h, channels)){
-        save_image(fileB, data, w, h,channels,quality);
+        save_image(fileB, data, w, h,channels,quality,restart,mips,effort);
     }
 
     if(data!=NULL){free(data);}
@@ -511,7 +555,11 @@ int main(int argc, char* argv[]) {
     std::vector<std::string> args(argv + 1, argv + argc);
     Mode mode = Mode::NONE;
     uint8_t imageQuality = 255;
+    uint32_t restart = 0;
+    uint32_t mips = 0;
+    uint8_t effort = SLIM_EFFORT_DEFAULT;
     bool overwrite = false;
+    bool fullinfo = false;
     std::vector<std::string> files;
 
     for (size_t i = 0; i < args.size(); ++i) {
@@ -537,6 +585,8 @@ int main(int argc, char* argv[]) {
             mode = Mode::ANALIZE;
         } else if (args[i] == "-y") {
             overwrite = true;
+        } else if (args[i] == "-f") {
+            fullinfo = true;
         } else if (args[i] == "-q") {
             if (i + 1 < args.size()) {
                 try {
@@ -549,6 +599,56 @@ int main(int argc, char* argv[]) {
             } else {
                 std::cerr << "Error: -q requires a quality value (0-255). Using default quality 255.\n";
             }
+        } else if (args[i] == "-r") {
+            if (i + 1 < args.size()) {
+                try {
+                    restart = (uint32_t)std::stoul(args[i + 1]);
+                    if (restart == 0) { restart = SLIM_RESTART_ROW; }
+                    ++i;
+                } catch (const std::exception& e) {
+                    std::cerr << "Error: Invalid restart interval. Restarts are disabled.\n";
+                    restart = 0;
+                }
+            } else {
+                std::cerr << "Error: -r requires a restart interval in blocks. Restarts are disabled.\n";
+            }
+        } else if (args[i] == "-p") {
+            if (i + 1 < args.size()) {
+                try {
+                    mips = (uint32_t)std::stoul(args[i + 1]);
+                    if (mips == 0) { mips = SLIM_MIP_FULL; }
+                    ++i;
+                } catch (const std::exception& e) {
+                    std::cerr << "Error: Invalid MIP level count. MIP levels are disabled.\n";
+                    mips = 0;
+                }
+            } else {
+                std::cerr << "Error: -p requires a MIP level count. MIP levels are disabled.\n";
+            }
+        } else if (args[i] == "-e") {
+            if (i + 1 < args.size()) {
+                try {
+                    effort = (uint8_t)std::min<unsigned long>(std::stoul(args[i + 1]), SLIM_EFFORT_MAX);
+                    ++i;
+                } catch (const std::exception& e) {
+                    std::cerr << "Error: Invalid effort level. Using default effort " << SLIM_EFFORT_DEFAULT << ".\n";
+                    effort = SLIM_EFFORT_DEFAULT;
+                }
+            } else {
+                std::cerr << "Error: -e requires an effort level (0-7). Using default effort " << SLIM_EFFORT_DEFAULT << ".\n";
+            }
+        } else if (args[i] == "-t") {
+            if (i + 1 < args.size()) {
+                try {
+                    SLIM_THREADS = (unsigned)std::stoul(args[i + 1]);
+                    ++i;
+                } catch (const std::exception& e) {
+                    std::cerr << "Error: Invalid thread count. Using all cores.\n";
+                    SLIM_THREADS = 0;
+                }
+            } else {
+                std::cerr << "Error: -t requires a thread count. Using all cores.\n";
+            }
         } else {
             if (!args[i].empty() && args[i][0] != '-') {
                 files.push_back(args[i]);
@@ -575,7 +675,7 @@ int main(int argc, char* argv[]) {
 
         if(!overwrite){if(!FileNotExistSave(files[1])){return 0;}}
 
-        ConvertIMG(files[0],files[1],imageQuality);
+        ConvertIMG(files[0],files[1],imageQuality,restart,mips,effort);
     }else if (mode == Mode::SAVEMAP) {
         if(files.size()<2){return -1;}
         if(files[0]==files[1]){return -1;}
@@ -590,7 +690,7 @@ int main(int argc, char* argv[]) {
         AnalizeIMG(files);
     } else if (mode == Mode::INFO) {
         if(files.size()<1){return -1;}
-        InfoIMG(files[0]);
+        InfoIMG(files[0],fullinfo);
     }
 
     return 0;
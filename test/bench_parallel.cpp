@@ -0,0 +1,88 @@
+//--------------------------------------------------------------//
+//Decoder thread scaling: an example image is tiled to a large
+//canvas, encoded with a restart every block row and decoded from
+//memory with 1, 2, 4, 8 and 16 threads.
+//
+//  bench_parallel [image.SLIM] [width] [height]
+//--------------------------------------------------------------//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "SLIM/miniSLIM.h"
+
+static double Seconds(std::chrono::steady_clock::time_point t0) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+
+int main(int argc, char* argv[]) {
+
+	const char* path	= (argc > 1) ? argv[1] : "example/cube.SLIM";
+	const uint32_t W	= (argc > 2) ? (uint32_t)atoi(argv[2]) : 3200u;
+	const uint32_t H	= (argc > 3) ? (uint32_t)atoi(argv[3]) : 4800u;
+
+	if (W == 0 || H == 0 || W > 0xFFFFu || H > 0xFFFFu) { printf("Bad canvas size\n"); return 1; }
+
+	SLIM_INFO src;
+	uint8_t* tile = NULL;
+
+	IStream infile(path, MiniStream::Read);
+
+	if (Load_SLIM(infile, src, tile) != SLIMERROR::ERROR_OK) { printf("Cannot load %s\n", path); return 1; }
+
+	const uint32_t channels = (src._CODE == SLIMCODE::CODE_RGBA) ? 4u : 3u;
+	const size_t raw		= (size_t)W * H * channels;
+
+	uint8_t* img = (uint8_t*)malloc(raw);
+
+	for (uint32_t y = 0; y < H; ++y) {
+		for (uint32_t x = 0; x < W; ++x) {
+			memcpy(img + ((size_t)y * W + x) * channels, tile + ((size_t)(y % src._HEIGHT) * src._WIDTH + x % src._WIDTH) * channels, channels);
+		}
+	}
+
+	Free_Buf(tile);
+
+	SLIM_INFO header = Create_Info((uint16_t)W, (uint16_t)H, src._CODE, FILTER_COLORDIV, 255, FLAG_INDEX, SLIM_RESTART_ROW);
+
+	MemoryStream encoded(MiniStream::Write, raw);
+
+	if (Save_SLIM_Parallel(encoded, header, img, 0) != SLIMERROR::ERROR_OK) { printf("Encode failed\n"); return 1; }
+
+	printf("%s tiled to %ux%u, %.1f MB raw, %.1f MB encoded\n", path, W, H, raw / 1e6, encoded.size() / 1e6);
+
+	const unsigned threads[] = { 1, 2, 4, 8, 16 };
+	double base = 0.0;
+
+	for (unsigned t : threads) {
+		double best = 1e30;
+
+		for (int run = 0; run < 5; ++run) {
+			MemoryStream view(encoded.data(), encoded.size());
+			SLIM_INFO dec;
+			uint8_t* out = NULL;
+
+			const auto t0 = std::chrono::steady_clock::now();
+
+			if (Load_SLIM_Parallel(view, dec, out, t) != SLIMERROR::ERROR_OK) { printf("Decode failed\n"); return 1; }
+
+			best = std::min(best, Seconds(t0));
+
+			if (run == 0 && memcmp(out, img, raw) != 0) { printf("Decoded image differs\n"); return 1; }
+
+			Free_Buf(out);
+		}
+
+		if (t == 1) { base = best; }
+
+		printf("threads %2u  %8.1f MB/s  x%.2f\n", t, raw / best / 1e6, base / best);
+	}
+
+	free(img);
+
+	return 0;
+}
@@ -0,0 +1,196 @@
+//--------------------------------------------------------------//
+//BufferedStream before and after: every example image is tiled
+//to a large canvas, saved to and loaded from a file through
+//IStream and through BufferedStream over IStream. Reports MB/s of
+//raw pixels (best of three), the calls reaching IStream and, on
+//Linux, the read and write syscalls from /proc/self/io.
+//
+//  bench_stream [width] [height] [scratch.SLIM]
+//--------------------------------------------------------------//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "SLIM/miniSLIM.h"
+
+//Counts the calls that reach the wrapped stream
+class CountStream final : public MiniStream {
+private:
+	MiniStream& inner_;
+
+public:
+	uint64_t calls = 0;
+
+	explicit CountStream(MiniStream& inner) : inner_(inner) { _mode = inner.getMode(); }
+
+	bool open(const char* filename, uint8_t mode) override { _mode = mode; return inner_.open(filename, mode); }
+	bool close() override { return inner_.close(); }
+	bool isOpen() const override { return inner_.isOpen(); }
+	bool write(const void* buffer, size_t size, size_t count) override { ++calls; return inner_.write(buffer, size, count); }
+	bool read(void* buffer, size_t size, size_t count) override { ++calls; return inner_.read(buffer, size, count); }
+	bool seek(size_t offset, uint8_t origin) override { ++calls; return inner_.seek(offset, origin); }
+	size_t getPos() const override { return inner_.getPos(); }
+	bool setPos(size_t t) override { ++calls; return inner_.setPos(t); }
+	size_t size() const override { return inner_.size(); }
+};
+
+
+//Read plus write syscalls of the process so far, 0 where unknown
+static uint64_t Syscalls() {
+
+	uint64_t total = 0;
+
+#if defined(__linux__)
+	FILE* f = fopen("/proc/self/io", "r");
+	if (f == NULL) { return 0; }
+
+	char key[64];
+	unsigned long long value;
+
+	while (fscanf(f, "%63[^:]: %llu\n", key, &value) == 2) {
+		if (!strcmp(key, "syscr") || !strcmp(key, "syscw")) { total += value; }
+	}
+
+	fclose(f);
+#endif
+
+	return total;
+}
+
+
+struct RUN {
+	double		seconds;
+	uint64_t	calls;
+	uint64_t	syscalls;
+};
+
+
+static RUN Save(const char* path, SLIM_INFO header, uint8_t* img, bool buffered) {
+
+	IStream file(path, MiniStream::Write);
+	CountStream count(file);
+
+	const uint64_t sys0	= Syscalls();
+	const auto t0		= std::chrono::steady_clock::now();
+
+	SLIMERROR res;
+
+	if (buffered) {
+		BufferedStream out(count);
+		res = Save_SLIM(out, header, img);
+		out.flush();
+	}
+	else {
+		res = Save_SLIM(count, header, img);
+	}
+
+	file.close();
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+	if (res != SLIMERROR::ERROR_OK) { printf("Save failed\n"); exit(1); }
+
+	return RUN{ seconds, count.calls, Syscalls() - sys0 };
+}
+
+
+static RUN Load(const char* path, uint8_t* &img, bool buffered) {
+
+	IStream file(path, MiniStream::Read);
+	CountStream count(file);
+
+	SLIM_INFO header;
+
+	const uint64_t sys0	= Syscalls();
+	const auto t0		= std::chrono::steady_clock::now();
+
+	SLIMERROR res;
+
+	if (buffered) {
+		BufferedStream in(count);
+		res = Load_SLIM(in, header, img);
+	}
+	else {
+		res = Load_SLIM(count, header, img);
+	}
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+	if (res != SLIMERROR::ERROR_OK) { printf("Load failed\n"); exit(1); }
+
+	return RUN{ seconds, count.calls, Syscalls() - sys0 };
+}
+
+
+int main(int argc, char* argv[]) {
+
+	const uint32_t W	= (argc > 1) ? (uint32_t)atoi(argv[1]) : 8192u;
+	const uint32_t H	= (argc > 2) ? (uint32_t)atoi(argv[2]) : 8192u;
+	const char* scratch	= (argc > 3) ? argv[3] : "bench_stream.SLIM";
+
+	if (W == 0 || H == 0 || W > 0xFFFFu || H > 0xFFFFu) { printf("Bad canvas size\n"); return 1; }
+
+	const char* images[] = { "example/cat.SLIM", "example/cube.SLIM", "example/slim_logo.SLIM", "example/trn.SLIM", "example/wall.SLIM" };
+
+	printf("%-24s %-6s %10s %10s %10s %10s %10s %10s\n", "image", "stream", "save MB/s", "calls", "syscalls", "load MB/s", "calls", "syscalls");
+
+	for (const char* path : images) {
+
+		SLIM_INFO src;
+		uint8_t* tile = NULL;
+
+		IStream infile(path, MiniStream::Read);
+
+		if (Load_SLIM(infile, src, tile) != SLIMERROR::ERROR_OK) { printf("Cannot load %s\n", path); return 1; }
+
+		const uint32_t channels = (src._CODE == SLIMCODE::CODE_RGBA) ? 4u : 3u;
+		const size_t raw		= (size_t)W * H * channels;
+
+		uint8_t* img = (uint8_t*)malloc(raw);
+
+		for (uint32_t y = 0; y < H; ++y) {
+			for (uint32_t x = 0; x < W; ++x) {
+				memcpy(img + ((size_t)y * W + x) * channels, tile + ((size_t)(y % src._HEIGHT) * src._WIDTH + x % src._WIDTH) * channels, channels);
+			}
+		}
+
+		Free_Buf(tile);
+
+		SLIM_INFO header = Create_Info((uint16_t)W, (uint16_t)H, src._CODE, FILTER_COLORDIV, 255);
+
+		uint8_t* decoded[2] = { NULL, NULL };
+
+		for (int buffered = 0; buffered < 2; ++buffered) {
+			RUN s = Save(scratch, header, img, buffered != 0);
+			RUN l = Load(scratch, decoded[buffered], buffered != 0);
+
+			//Best of three, the counts do not change between runs
+			for (int run = 1; run < 3; ++run) {
+				uint8_t* again = NULL;
+
+				s.seconds = std::min(s.seconds, Save(scratch, header, img, buffered != 0).seconds);
+				l.seconds = std::min(l.seconds, Load(scratch, again, buffered != 0).seconds);
+
+				Free_Buf(again);
+			}
+
+			printf("%-24s %-6s %10.1f %10llu %10llu %10.1f %10llu %10llu\n", path, buffered ? "buffer" : "direct",
+				raw / s.seconds / 1e6, (unsigned long long)s.calls, (unsigned long long)s.syscalls,
+				raw / l.seconds / 1e6, (unsigned long long)l.calls, (unsigned long long)l.syscalls);
+		}
+
+		//Both streams must decode to the same pixels
+		if (memcmp(decoded[0], decoded[1], raw) != 0) { printf("Buffered decode differs\n"); return 1; }
+
+		Free_Buf(decoded[0]);
+		Free_Buf(decoded[1]);
+		free(img);
+	}
+
+	remove(scratch);
+
+	return 0;
+}
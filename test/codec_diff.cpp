@@ -0,0 +1,348 @@
+//--------------------------------------------------------------//
+//Codec kernels against their portable paths: every buffer is
+//encoded and decoded with the detected CPU features, with CPU_ALLOWED
+//cleared and, where a codec has several kernels, with the ones in
+//between. Encoded bytes, sizes and decoded output must match. Also checks the vendor and family rule for PEXT/PDEP
+//and that CPU_FEATURES honors CPU_ALLOWED.
+//
+//  codec_diff [seed]
+//--------------------------------------------------------------//
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "SLIM/miniSLIM.h"
+
+static uint32_t failures = 0;
+
+#define CHECK(cond, ...) do { if (!(cond)) { ++failures; printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); } } while (0)
+
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ull;
+
+static uint32_t Rand() {
+
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return (uint32_t)(rng_state >> 32);
+}
+
+
+//Byte mask with a bias towards the edge cases 0x00 and 0xFF
+static uint8_t RandMask() {
+
+	switch (Rand() % 8u) {
+	case 0:		return 0x00u;
+	case 1:		return 0xFFu;
+	default:	return (uint8_t)Rand();
+	}
+}
+
+
+//Feature sets each codec is run with, the first one is the reference
+struct FEATURES {
+	const char*	name;
+	uint32_t	allowed;
+};
+
+
+//--------------------------------------------------------------//
+//CPUID
+//--------------------------------------------------------------//
+
+//EBX, ECX, EDX of CPUID leaf 0 for a vendor string
+static void Vendor(const char* name, uint32_t vendor[3]) {
+
+	memcpy(&vendor[0], name + 0, 4);
+	memcpy(&vendor[2], name + 4, 4);
+	memcpy(&vendor[1], name + 8, 4);
+}
+
+
+static void TestCPUID() {
+
+	struct CASE {
+		const char*	vendor;
+		uint32_t	family;
+		bool		fast;
+	};
+
+	const CASE cases[] = {
+		{ "AuthenticAMD", 0x15u, false },	//Excavator
+		{ "AuthenticAMD", 0x17u, false },	//Zen 1, Zen 2
+		{ "AuthenticAMD", 0x19u, true  },	//Zen 3, Zen 4
+		{ "AuthenticAMD", 0x1Au, true  },	//Zen 5
+		{ "HygonGenuine", 0x18u, false },	//Dhyana, Zen 1
+		{ "GenuineIntel", 0x06u, true  },
+		{ "CentaurHauls", 0x06u, true  },
+	};
+
+	for (const CASE& c : cases) {
+		uint32_t vendor[3];
+		Vendor(c.vendor, vendor);
+		CHECK(CPU_PDEP_FAST(vendor, c.family) == c.fast, "CPU_PDEP_FAST %s family %02Xh", c.vendor, c.family);
+	}
+
+	const uint32_t detected = CPU_FEATURES();
+
+	CHECK(!(detected & CPU_FAST_PDEP) || (detected & CPU_BMI2), "CPU_FAST_PDEP without CPU_BMI2");
+
+#if CPU_X64
+	uint32_t r[4];
+	CPU_QUERY(0, 0, r);
+	const uint32_t vendor[3] = { r[1], r[2], r[3] };
+
+	CPU_QUERY(1, 0, r);
+	uint32_t family = (r[0] >> 8) & 0x0Fu;
+	if (family == 0x0Fu) { family += (r[0] >> 20) & 0xFFu; }
+
+	CHECK(detected == CPU_DETECT(), "CPU_FEATURES differs from CPU_DETECT");
+	CHECK(((detected & CPU_FAST_PDEP) != 0) == ((detected & CPU_BMI2) && CPU_PDEP_FAST(vendor, family)), "CPU_FAST_PDEP does not follow the vendor rule");
+#endif
+
+	CPU_ALLOWED() = 0;
+	CHECK(CPU_FEATURES() == 0, "CPU_ALLOWED = 0 leaves %02Xh", CPU_FEATURES());
+
+	CPU_ALLOWED() = ~0u & ~CPU_FAST_PDEP;
+	CHECK(CPU_FEATURES() == (detected & ~CPU_FAST_PDEP), "CPU_ALLOWED does not clear CPU_FAST_PDEP");
+
+	CPU_ALLOWED() = ~0u;
+	CHECK(CPU_FEATURES() == detected, "CPU_ALLOWED = ~0 does not restore the features");
+
+	printf("CPUID     features %02Xh, %u vendor cases\n", detected, (uint32_t)(sizeof(cases) / sizeof(cases[0])));
+}
+
+
+//--------------------------------------------------------------//
+//MASKARED
+//--------------------------------------------------------------//
+
+static void TestMASKARED() {
+
+	const FEATURES runs[] = {
+		{ "scalar",	0u },
+		{ "bmi2",	~0u },
+	};
+
+	uint32_t count = 0;
+
+	for (uint32_t size = 1; size <= 256; ++size) {
+		for (uint32_t rep = 0; rep < 32; ++rep, ++count) {
+
+			//Bits outside the mask are constant, the ones under it random
+			uint8_t buf[256];
+			const uint8_t mask = RandMask();
+			const uint8_t base = (uint8_t)Rand();
+
+			for (uint32_t i = 0; i < size; ++i) { buf[i] = (uint8_t)((base & ~mask) | (Rand() & mask)); }
+
+			uint8_t  ref[512];
+			uint32_t ref_size = 0;
+
+			for (const FEATURES& run : runs) {
+				CPU_ALLOWED() = run.allowed;
+
+				uint8_t  enc[512];
+				uint8_t* penc		= enc;
+				uint32_t enc_size	= 0;
+				uint32_t calc		= 0;
+
+				MASKARED_ENCODE(buf, size, penc, enc_size);
+				MASKARED_SIZE_CALC(buf, size, calc);
+
+				CHECK(calc == enc_size, "MASKARED %s size %u mask %02Xh: SIZE_CALC %u, ENCODE %u", run.name, size, mask, calc, enc_size);
+
+				if (&run == runs) {
+					memcpy(ref, enc, enc_size);
+					ref_size = enc_size;
+				}
+				else {
+					CHECK(enc_size == ref_size && !memcmp(enc, ref, enc_size), "MASKARED %s size %u mask %02Xh: encoded bytes differ", run.name, size, mask);
+				}
+
+				//Both kernels decode the reference stream
+				uint8_t  dec[256];
+				uint8_t* pdec = dec;
+
+				MASKARED_DECODE(ref, ref_size, pdec, size);
+
+				CHECK(!memcmp(dec, buf, size), "MASKARED %s size %u mask %02Xh: decoded output differs", run.name, size, mask);
+			}
+		}
+	}
+
+	CPU_ALLOWED() = ~0u;
+
+	printf("MASKARED  %u buffers, BMI2 kernel %s\n", count, (CPU_FEATURES() & CPU_FAST_PDEP) ? "on" : "off");
+}
+
+
+//--------------------------------------------------------------//
+//SLDD
+//--------------------------------------------------------------//
+
+static void TestSLDD() {
+
+	const FEATURES runs[] = {
+		{ "scalar",	0u },
+		{ "sse2",	CPU_SSE2 },
+		{ "avx2",	~0u },
+	};
+
+	uint32_t count = 0;
+
+	for (uint32_t size = 1; size <= 256; ++size) {
+		for (uint32_t rep = 0; rep < 32; ++rep, ++count) {
+
+			//Random middle bits between constant runs of high and low bits
+			uint8_t buf[256];
+			const uint32_t left		= Rand() % 9u;
+			const uint32_t right	= Rand() % (9u - left);
+			const uint8_t  middle	= (uint8_t)((0xFFu >> left) & (0xFFu << right));
+			const uint8_t  edge		= (uint8_t)Rand();
+
+			for (uint32_t i = 0; i < size; ++i) { buf[i] = (uint8_t)((edge & ~middle) | (Rand() & middle)); }
+
+			uint8_t  ref[512];
+			uint32_t ref_size = 0;
+
+			for (const FEATURES& run : runs) {
+				CPU_ALLOWED() = run.allowed;
+
+				uint8_t  enc[512];
+				uint8_t* penc		= enc;
+				uint32_t enc_size	= 0;
+				uint32_t calc		= 0;
+
+				SLDD_ENCODE(buf, size, penc, enc_size);
+				SLDD_SIZE_CALC(buf, size, calc);
+
+				CHECK(calc == enc_size, "SLDD %s size %u middle %02Xh: SIZE_CALC %u, ENCODE %u", run.name, size, middle, calc, enc_size);
+
+				if (&run == runs) {
+					memcpy(ref, enc, enc_size);
+					ref_size = enc_size;
+				}
+				else {
+					CHECK(enc_size == ref_size && !memcmp(enc, ref, enc_size), "SLDD %s size %u middle %02Xh: encoded bytes differ", run.name, size, middle);
+				}
+
+				//Every kernel decodes the reference stream
+				uint8_t  dec[256];
+				uint8_t* pdec		= dec;
+				uint32_t dec_size	= size;
+
+				SLDD_DECODE(ref, ref_size, pdec, dec_size);
+
+				CHECK(!memcmp(dec, buf, size), "SLDD %s size %u middle %02Xh: decoded output differs", run.name, size, middle);
+			}
+		}
+	}
+
+	CPU_ALLOWED() = ~0u;
+
+	printf("SLDD      %u buffers, AVX2 kernel %s\n", count, (CPU_FEATURES() & CPU_AVX2) ? "on" : "off");
+}
+
+
+//--------------------------------------------------------------//
+//RLE
+//--------------------------------------------------------------//
+
+static void TestRLE() {
+
+	const FEATURES runs[] = {
+		{ "scalar",	0u },
+		{ "sse2",	~0u },
+	};
+
+	uint32_t count = 0;
+
+	for (uint32_t size = 1; size <= 256; ++size) {
+		for (uint32_t rep = 0; rep < 32; ++rep, ++count) {
+
+			//Runs of up to 160 bytes, so some pass the 127 byte token limit, between literals
+			uint8_t buf[256];
+
+			for (uint32_t i = 0; i < size;) {
+				const uint32_t len	= (Rand() % 4u == 0) ? 1u + Rand() % 160u : 1u + Rand() % 20u;
+				const bool run		= (Rand() % 2u) != 0;
+				const uint8_t value	= (uint8_t)Rand();
+
+				for (uint32_t k = 0; k < len && i < size; ++k, ++i) { buf[i] = run ? value : (uint8_t)(Rand() % 4u); }
+			}
+
+			uint8_t  ref[512];
+			uint32_t ref_size = 0;
+
+			for (const FEATURES& run : runs) {
+				CPU_ALLOWED() = run.allowed;
+
+				uint8_t  enc[512];
+				uint8_t* penc		= enc;
+				uint32_t enc_size	= 0;
+				uint32_t calc		= 0;
+
+				RLE_ENCODE(buf, size, penc, enc_size);
+				RLE_SIZE_CALC(buf, size, calc);
+
+				CHECK(calc == enc_size, "RLE %s size %u: SIZE_CALC %u, ENCODE %u", run.name, size, calc, enc_size);
+
+				if (&run == runs) {
+					memcpy(ref, enc, enc_size);
+					ref_size = enc_size;
+				}
+				else {
+					CHECK(enc_size == ref_size && !memcmp(enc, ref, enc_size), "RLE %s size %u: encoded bytes differ", run.name, size);
+				}
+			}
+
+			//Both decoders give the input back, the checked one writes nothing past its capacity
+			uint8_t  dec[256 + 16];
+			uint8_t* pdec		= dec;
+			uint32_t dec_size	= 0;
+
+			RLE_DECODE(ref, ref_size, pdec, dec_size);
+
+			CHECK(dec_size == size && !memcmp(dec, buf, size), "RLE_DECODE size %u: decoded output differs", size);
+
+			memset(dec, 0xA5, sizeof(dec));
+
+			const RLE_RESULT res = RLE_DECODE_SAFE(ref, ref_size, pdec, dec_size, size);
+
+			bool guard = true;
+			for (uint32_t i = size; i < sizeof(dec); ++i) { guard = guard && dec[i] == 0xA5u; }
+
+			CHECK(res == RLE_OK && dec_size == size && !memcmp(dec, buf, size), "RLE_DECODE_SAFE size %u: decoded output differs", size);
+			CHECK(guard, "RLE_DECODE_SAFE size %u: wrote past the capacity", size);
+			CHECK(RLE_DECODE_SAFE(ref, ref_size, pdec, dec_size, size - 1) == RLE_ERROR_DATA, "RLE_DECODE_SAFE size %u: accepted a short capacity", size);
+		}
+	}
+
+	CPU_ALLOWED() = ~0u;
+
+	printf("RLE       %u buffers, SSE2 kernel %s\n", count, (CPU_FEATURES() & CPU_SSE2) ? "on" : "off");
+}
+
+
+int main(int argc, char* argv[]) {
+
+	if (argc > 1) { rng_state = strtoull(argv[1], NULL, 0) | 1u; }
+
+	TestCPUID();
+	TestMASKARED();
+	TestSLDD();
+	TestRLE();
+
+	if (failures > 0) {
+		printf("%u checks failed\n", failures);
+		return 1;
+	}
+
+	printf("All checks passed\n");
+
+	return 0;
+}